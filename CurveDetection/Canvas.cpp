@@ -6,104 +6,234 @@
 #include <QMessageBox>
 #include <QTextStream>
 #include <QResizeEvent>
+#include <QWheelEvent>
+#include <algorithm>
+#include <cmath>
+#include "../CurveDetectionNoGUI/Tracer.h"
+
+namespace {
+
+const float MIN_SCALE = 0.01f;
+const float MAX_SCALE = 32.0f;
+const float ZOOM_STEP = 1.25f;		// per notch of the mouse wheel
+const int MIN_PYRAMID_SIZE = 64;
+const float MIN_INLIER_SCALE = 0.25f;	// the inliers are too dense to be worth marking below this scale
+const int RENDER_DELAY = 150;		// milliseconds without panning or zooming before the layers are redrawn
+
+cv::Rect2f boundsOf(const Point* points, int size) {
+	if (size == 0) return cv::Rect2f();
+
+	float min_x = points[0].pos.x, max_x = min_x;
+	float min_y = points[0].pos.y, max_y = min_y;
+	for (int i = 1; i < size; i++) {
+		min_x = std::min(min_x, points[i].pos.x);
+		max_x = std::max(max_x, points[i].pos.x);
+		min_y = std::min(min_y, points[i].pos.y);
+		max_y = std::max(max_y, points[i].pos.y);
+	}
+	return cv::Rect2f(min_x, min_y, max_x - min_x, max_y - min_y);
+}
+
+cv::Rect2f boundsOf(const Circle& circle) {
+	return cv::Rect2f(circle.center.x - circle.radius, circle.center.y - circle.radius, circle.radius * 2, circle.radius * 2);
+}
+
+cv::Rect2f boundsOf(const Line& line) {
+	cv::Point2f p1 = line.point + line.dir * line.start_pos;
+	cv::Point2f p2 = line.point + line.dir * line.end_pos;
+	return cv::Rect2f(std::min(p1.x, p2.x), std::min(p1.y, p2.y), std::abs(p2.x - p1.x), std::abs(p2.y - p1.y));
+}
+
+/**
+ * Return whether the rectangles overlap, counting the ones of zero width or height, such as the bounds of a
+ * horizontal or vertical line.
+ */
+bool overlaps(const cv::Rect2f& a, const cv::Rect2f& b) {
+	return a.x <= b.x + b.width && b.x <= a.x + a.width && a.y <= b.y + b.height && b.y <= a.y + a.height;
+}
+
+/**
+ * Return the step between the points to draw of a curve whose points are about one image pixel apart, so that the
+ * drawn points stay about one screen pixel apart when zoomed out.
+ */
+int detailStep(float view_scale) {
+	return std::max(1, (int)(1.0f / view_scale));
+}
+
+}
 
 Canvas::Canvas(QWidget *parent) : QWidget(parent) {
 	ctrlPressed = false;
 	shiftPressed = false;
+	density = 1;
+	view_scale = 1;
+	fit_to_window = true;
+	panning = false;
+	rings_indexed = false;
+	num_indexed_circles = 0;
+	num_indexed_lines = 0;
+	contour_layer_valid = false;
+	primitive_layer_valid = false;
+	contour_layer_scale = 1;
+	primitive_layer_scale = 1;
+
+	// the view is fitted with the Home key
+	setFocusPolicy(Qt::StrongFocus);
 }
 
 void Canvas::loadImage(const QString& filename) {
+	TraceScope trace("loadImage");
 	orig_image = QImage(filename).convertToFormat(QImage::Format_Grayscale8);
-	image_scale = std::min((float)width() / orig_image.width(), (float)height() / orig_image.height());
-	image = orig_image.scaled(orig_image.width() * image_scale, orig_image.height() * image_scale);
+
+	pyramid.clear();
+	if (!orig_image.isNull()) {
+		pyramid.push_back(orig_image);
+		while (std::min(pyramid.back().width(), pyramid.back().height()) >= MIN_PYRAMID_SIZE * 2) {
+			pyramid.push_back(pyramid.back().scaled(pyramid.back().width() / 2, pyramid.back().height() / 2, Qt::IgnoreAspectRatio, Qt::SmoothTransformation));
+		}
+	}
 
 	polygons.clear();
+	density = 1;
 	circles.clear();
 	lines.clear();
-
-	update();
+	invalidateIndex();
+	fitToWindow();
 }
 
 void Canvas::detectContours() {
 	if (orig_image.isNull()) return;
 
 	polygons.clear();
+	density = 1;
 	circles.clear();
 	lines.clear();
+	invalidateIndex();
+	invalidateLayers();
 
-	cv::Mat mat = cv::Mat(orig_image.height(), orig_image.width(), CV_8UC1, orig_image.bits(), orig_image.bytesPerLine()).clone();
-	polygons = findContours(mat);
+	{
+		TraceScope trace("threshold");
+		binary_image.create(ImageView(orig_image.constBits(), orig_image.width(), orig_image.height(), orig_image.bytesPerLine()));
+	}
+	TraceScope trace("findContours");
+	findContours(binary_image, polygons);
 }
 
-void Canvas::detectCurves(int num_iterations, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius) {
+void Canvas::detectCenterlines() {
+	if (orig_image.isNull()) return;
+
+	polygons.clear();
+	density = 1;
 	circles.clear();
 	lines.clear();
+	invalidateIndex();
+	invalidateLayers();
+
+	TraceScope trace("extractCenterlines");
+	CenterlineExtractor::extract(ImageView(orig_image.constBits(), orig_image.width(), orig_image.height(), orig_image.bytesPerLine()), contour_buffer, polygons);
+}
 
+/**
+ * Thin out the smooth parts of the polygons to points about spacing pixels apart, so that the detectors go through
+ * fewer of them.
+ * The contours are extracted first if there are none yet.
+ */
+void Canvas::resampleContours(float spacing) {
+	if (orig_image.isNull()) return;
 	if (polygons.size() == 0) detectContours();
 
-	for (int i = 0; i < polygons.size(); i++) {
-		if (polygons[i].contour.size() < 100) continue;
+	circles.clear();
+	lines.clear();
+	invalidateIndex();
+	invalidateLayers();
 
-		std::vector<Circle> results;
-		CurveDetector::detect(polygons[i].contour, num_iterations, min_points, max_error_ratio_to_radius, cluster_epsilon, min_angle, min_radius, max_radius, results);
-		circles.insert(circles.end(), results.begin(), results.end());
-	}
+	TraceScope trace("resampleContours");
+	::resampleContours(polygons, resampled, spacing);
+	density = std::min(density, resampledDensity(spacing));
+	polygons.swap(resampled);
 }
 
-void Canvas::detectLines(int num_iterations, int min_points, float max_error, float cluster_epsilon, float min_length) {
-	//circles.clear();
+/**
+ * Clear the primitives that the detection will find again, and return the polygons to detect them in, which are
+ * the contours unless they or the centerlines have been extracted already.
+ */
+const PolygonSet& Canvas::beginDetection(const DetectionSettings& settings) {
+	if (settings.detect_curves) {
+		circles.clear();
+		num_indexed_circles = 0;
+	}
 	lines.clear();
+	num_indexed_lines = 0;
+	primitive_layer_valid = false;
 
 	if (polygons.size() == 0) detectContours();
 
-	std::vector<std::vector<cv::Point2f>> pgons;
-	for (auto& polygon : polygons) {
-		if (polygon.contour.size() < 100) continue;
+	return polygons;
+}
 
-		std::vector<cv::Point2f> pgon;
-		for (auto& pt : polygon.contour) pgon.push_back(pt.pos);
-		pgons.push_back(pgon);
+/**
+ * Draw the primitives that a running detection has found so far, along with the ones already shown.
+ */
+void Canvas::addPrimitives(const std::vector<Circle>& new_circles, const std::vector<Line>& new_lines) {
+	circles.insert(circles.end(), new_circles.begin(), new_circles.end());
+	lines.insert(lines.end(), new_lines.begin(), new_lines.end());
+
+	// only the new ones that are visible are drawn over the layer of the primitives shown already, unless the layer
+	// was drawn at another view, while panning or zooming, in which case it is drawn again at the current one
+	if (primitive_layer_valid && (primitive_layer_origin != view_origin || primitive_layer_scale != view_scale)) {
+		primitive_layer_valid = false;
+	}
+	if (primitive_layer_valid) {
+		cv::Rect2f area = visibleArea();
+		std::vector<int> circle_ids;
+		std::vector<int> line_ids;
+		for (int i = circles.size() - new_circles.size(); i < circles.size(); i++) {
+			if (overlaps(boundsOf(circles[i]), area)) circle_ids.push_back(i);
+		}
+		for (int i = lines.size() - new_lines.size(); i < lines.size(); i++) {
+			if (overlaps(boundsOf(lines[i]), area)) line_ids.push_back(i);
+		}
+		renderPrimitives(primitive_layer, circle_ids, line_ids);
 	}
-	float principal_orientation = OrientationEstimator::estimate(pgons);
 
-	std::vector<float> principal_orientations;
-	principal_orientations.push_back(principal_orientation);
-	principal_orientations.push_back(principal_orientation + CV_PI / 2);
-	principal_orientations.push_back(principal_orientation + CV_PI / 3);
-	principal_orientations.push_back(principal_orientation + CV_PI / 4);
-	principal_orientations.push_back(principal_orientation + CV_PI / 6);
+	update();
+}
 
-	/*
-	// detect lines for estimating the principal orientations
-	for (int i = 0; i < polygons.size(); i++) {
-		if (polygons[i].contour.size() < 100) continue;
+/**
+ * Take the polygons of a finished detection, whose points are now marked as used by the primitives found, so that
+ * a later detection only searches the remaining points.
+ */
+void Canvas::endDetection(const DetectionWorker& worker) {
+	polygons = worker.getPolygons();
 
-		std::vector<Line> results;
-		LineDetector::detect(polygons[i].contour, num_iterations, min_points * 3, max_error, cluster_epsilon * 3, min_length * 3, {}, results);
-		lines.insert(lines.end(), results.begin(), results.end());
-	}
+	update();
+}
 
-	// collect orientation angles
-	std::vector<float> angles;
-	for (auto& line : lines) {
-		float angle = std::atan2(line.dir.y, line.dir.x);
-		if (angle < 0) angle += CV_PI;
-		angles.push_back(angle);
-	}
+/**
+ * Show the whole image, and keep it fitted when the window is resized until the view is zoomed or panned.
+ */
+void Canvas::fitToWindow() {
+	if (!orig_image.isNull()) view_scale = std::min((float)width() / orig_image.width(), (float)height() / orig_image.height());
+	view_origin = cv::Point2f(0, 0);
+	fit_to_window = true;
+	invalidateLayers();
 
-	// mean shift to cluster angles
-	std::vector<float> principal_angles = MeanShift::cluster(angles, 0.1f, 0.1f, 10, 0.1f);
-	*/
+	update();
+}
 
-	// detect lines based on the principal orientations
-	lines.clear();
-	for (int i = 0; i < polygons.size(); i++) {
-		if (polygons[i].contour.size() < 100) continue;
+/**
+ * Change the scale of the view, keeping the image point under the screen position in place. The layers are
+ * scaled until the wheel stops turning, and only then drawn again at the new scale.
+ */
+void Canvas::zoomAt(const QPoint& pos, float scale) {
+	scale = std::min(std::max(scale, MIN_SCALE), MAX_SCALE);
+	cv::Point2f p = view_origin + cv::Point2f(pos.x(), pos.y()) / view_scale;
+	view_origin = p - cv::Point2f(pos.x(), pos.y()) / scale;
+	view_scale = scale;
+	fit_to_window = false;
+	scheduleRender();
 
-		std::vector<Line> results;
-		LineDetector::detect(polygons[i].contour, num_iterations, min_points, max_error, cluster_epsilon, min_length, principal_orientations, results);
-		lines.insert(lines.end(), results.begin(), results.end());
-	}
+	update();
 }
 
 void Canvas::keyPressEvent(QKeyEvent* e) {
@@ -120,6 +250,9 @@ void Canvas::keyPressEvent(QKeyEvent* e) {
 	switch (e->key()) {
 	case Qt::Key_Space:
 		break;
+	case Qt::Key_Home:
+		fitToWindow();
+		break;
 	}
 
 	update();
@@ -138,60 +271,254 @@ void Canvas::keyReleaseEvent(QKeyEvent* e) {
 	}
 }
 
-void Canvas::paintEvent(QPaintEvent *event) {
-	if (!image.isNull()) {
-		QPainter painter(this);
+/**
+ * Index the polygons and the primitives again from scratch at the next paint, after they have been replaced.
+ */
+void Canvas::invalidateIndex() {
+	rings_indexed = false;
+	num_indexed_circles = 0;
+	num_indexed_lines = 0;
+}
+
+/**
+ * Add the rings and the primitives that are not indexed yet. The primitives only grow during a detection, so the
+ * ones streamed in are added to the index without rebuilding it.
+ */
+void Canvas::updateIndex() {
+	if (!rings_indexed) {
+		ring_index.reset(orig_image.width(), orig_image.height());
+		for (int r = 0; r < polygons.numRings(); r++) ring_index.insert(r, boundsOf(polygons.ring(r), polygons.ringSize(r)));
+		rings_indexed = true;
+	}
 
-		if (polygons.size() == 0) painter.drawImage(0, 0, image);
+	if (num_indexed_circles == 0) circle_index.reset(orig_image.width(), orig_image.height());
+	for (; num_indexed_circles < circles.size(); num_indexed_circles++) {
+		circle_index.insert(num_indexed_circles, boundsOf(circles[num_indexed_circles]));
+	}
 
-		painter.setPen(QPen(QColor(0, 0, 0), 1));
-		for (auto& polygon : polygons) {
-			QPolygon pgon;
-			for (auto& p : polygon.contour) {
-				pgon.push_back(QPoint(p.pos.x * image_scale, p.pos.y * image_scale));
+	if (num_indexed_lines == 0) line_index.reset(orig_image.width(), orig_image.height());
+	for (; num_indexed_lines < lines.size(); num_indexed_lines++) {
+		line_index.insert(num_indexed_lines, boundsOf(lines[num_indexed_lines]));
+	}
+}
+
+void Canvas::invalidateLayers() {
+	render_timer.stop();
+	contour_layer_valid = false;
+	primitive_layer_valid = false;
+}
+
+/**
+ * Draw the layers again at the current view once it has not changed for RENDER_DELAY, rather than at every step
+ * of a pan or a zoom. Until then, the layers drawn at the previous view are moved and scaled into place.
+ */
+void Canvas::scheduleRender() {
+	render_timer.start(RENDER_DELAY, this);
+}
+
+/**
+ * Return the part of the image in the view, widened by the pen widths so that the strokes of the items just
+ * outside are drawn too.
+ */
+cv::Rect2f Canvas::visibleArea() const {
+	float margin = 3 / view_scale;
+	return cv::Rect2f(view_origin.x - margin, view_origin.y - margin, width() / view_scale + margin * 2, height() / view_scale + margin * 2);
+}
+
+QPointF Canvas::toScreen(const cv::Point2f& p) const {
+	return QPointF((p.x - view_origin.x) * view_scale, (p.y - view_origin.y) * view_scale);
+}
+
+/**
+ * Draw the visible rings of the polygons into the contour layer, skipping points that would fall on the same
+ * screen pixel when zoomed out, and drawing the rings smaller than a pixel as points.
+ */
+void Canvas::renderContourLayer() {
+	TraceScope trace("renderContours");
+	contour_layer = QPixmap(size());
+	contour_layer.fill(Qt::transparent);
+
+	std::vector<int> ids;
+	ring_index.query(visibleArea(), ids);
+
+	QPainter painter(&contour_layer);
+	painter.setPen(QPen(QColor(0, 0, 0), 1));
+	int step = detailStep(view_scale);
+	QPolygonF pgon;
+	for (int r : ids) {
+		const Point* ring = polygons.ring(r);
+		int size = polygons.ringSize(r);
+		if (size == 0) continue;
+
+		cv::Rect2f bounds = boundsOf(ring, size);
+		if (bounds.width * view_scale < 1 && bounds.height * view_scale < 1) {
+			painter.drawPoint(toScreen(ring[0].pos));
+			continue;
+		}
+
+		pgon.clear();
+		for (int j = 0; j < size; j += step) pgon.push_back(toScreen(ring[j].pos));
+		if ((size - 1) % step != 0) pgon.push_back(toScreen(ring[size - 1].pos));
+		if (polygons.isClosed(r)) painter.drawPolygon(pgon);
+		else painter.drawPolyline(pgon);
+	}
+
+	contour_layer_valid = true;
+	contour_layer_origin = view_origin;
+	contour_layer_scale = view_scale;
+}
+
+/**
+ * Draw the primitives over the layer, with the inliers of all of them as one batch of rectangles under the arcs
+ * and the segments, so that the number of draw calls does not grow with the number of inliers. The inliers are
+ * thinned out like the contours, and left out altogether below MIN_INLIER_SCALE.
+ */
+void Canvas::renderPrimitives(QPixmap& layer, const std::vector<int>& circle_ids, const std::vector<int>& line_ids) {
+	TraceScope trace("renderPrimitives");
+	QVector<QRectF> inliers;
+	if (view_scale >= MIN_INLIER_SCALE) {
+		int step = detailStep(view_scale);
+		for (int i : circle_ids) {
+			for (int j = 0; j < circles[i].points.size(); j += step) {
+				QPointF p = toScreen(circles[i].points[j]);
+				inliers.push_back(QRectF(p.x() - 1, p.y() - 1, 3, 3));
 			}
-			painter.drawPolygon(pgon);
-			for (auto& hole : polygon.holes) {
-				QPolygon pgon;
-				for (auto& p : hole) {
-					pgon.push_back(QPoint(p.pos.x * image_scale, p.pos.y * image_scale));
-				}
-				painter.drawPolygon(pgon);
+		}
+		for (int i : line_ids) {
+			for (int j = 0; j < lines[i].points.size(); j += step) {
+				QPointF p = toScreen(lines[i].points[j]);
+				inliers.push_back(QRectF(p.x() - 1, p.y() - 1, 3, 3));
 			}
 		}
+	}
 
-		for (auto& circle : circles) {
-			painter.setPen(QPen(QColor(255, 0, 0), 1));
-			for (int i = 0; i < circle.points.size(); i++) {
-				painter.drawRect(circle.points[i].x * image_scale - 1, circle.points[i].y * image_scale - 1, 3, 3);
-			}
+	QPainter painter(&layer);
+	painter.setPen(QPen(QColor(255, 0, 0), 1));
+	painter.drawRects(inliers);
 
-			painter.setPen(QPen(QColor(255, 0, 255), 3));
-			painter.drawArc((circle.center.x - circle.radius) * image_scale, (circle.center.y - circle.radius) * image_scale, circle.radius * 2 * image_scale, circle.radius * 2 * image_scale, -circle.start_angle / CV_PI * 180 * 16, -circle.angle_range / CV_PI * 180 * 16);
-		}
+	painter.setPen(QPen(QColor(255, 0, 255), 3));
+	for (int i : circle_ids) {
+		const Circle& circle = circles[i];
+		QPointF corner = toScreen(circle.center - cv::Point2f(circle.radius, circle.radius));
+		painter.drawArc(QRectF(corner.x(), corner.y(), circle.radius * 2 * view_scale, circle.radius * 2 * view_scale), -circle.start_angle / CV_PI * 180 * 16, -circle.angle_range / CV_PI * 180 * 16);
+	}
 
-		for (auto& line : lines) {
-			painter.setPen(QPen(QColor(255, 0, 0), 1));
-			for (int i = 0; i < line.points.size(); i++) {
-				painter.drawRect(line.points[i].x * image_scale - 1, line.points[i].y * image_scale - 1, 3, 3);
-			}
+	QVector<QLineF> segments;
+	for (int i : line_ids) {
+		const Line& line = lines[i];
+		segments.push_back(QLineF(toScreen(line.point + line.dir * line.start_pos), toScreen(line.point + line.dir * line.end_pos)));
+	}
+	painter.setPen(QPen(QColor(0, 0, 255), 3));
+	painter.drawLines(segments);
+}
+
+/**
+ * Compose the image and the cached layers, rendering a layer again only if its content or the view has changed.
+ * The background is drawn from the smallest level of the pyramid that is still as fine as the screen.
+ */
+void Canvas::paintEvent(QPaintEvent *event) {
+	if (!orig_image.isNull()) {
+		TraceScope trace("paint");
+		updateIndex();
+		if (!contour_layer_valid) renderContourLayer();
+		if (!primitive_layer_valid) {
+			primitive_layer = QPixmap(size());
+			primitive_layer.fill(Qt::transparent);
+			std::vector<int> circle_ids;
+			std::vector<int> line_ids;
+			circle_index.query(visibleArea(), circle_ids);
+			line_index.query(visibleArea(), line_ids);
+			renderPrimitives(primitive_layer, circle_ids, line_ids);
+			primitive_layer_valid = true;
+			primitive_layer_origin = view_origin;
+			primitive_layer_scale = view_scale;
+		}
 
-			painter.setPen(QPen(QColor(0, 0, 255), 3));
-			cv::Point2f p1 = line.point + line.dir * line.start_pos;
-			cv::Point2f p2 = line.point + line.dir * line.end_pos;
-			painter.drawLine(p1.x * image_scale, p1.y * image_scale, p2.x * image_scale, p2.y * image_scale);
+		QPainter painter(this);
+		if (polygons.size() == 0) {
+			int level = 0;
+			while (level + 1 < pyramid.size() && view_scale * orig_image.width() <= pyramid[level + 1].width()) level++;
+
+			float level_scale = (float)pyramid[level].width() / orig_image.width();
+			QRectF source(view_origin.x * level_scale, view_origin.y * level_scale, width() / view_scale * level_scale, height() / view_scale * level_scale);
+			painter.setRenderHint(QPainter::SmoothPixmapTransform);
+			painter.drawImage(QRectF(rect()), pyramid[level], source);
 		}
+		drawLayer(painter, contour_layer, contour_layer_origin, contour_layer_scale);
+		drawLayer(painter, primitive_layer, primitive_layer_origin, primitive_layer_scale);
 	}
 }
 
+/**
+ * Draw a layer that was rendered with the view at origin and scale where it falls in the current view. A pan only
+ * moves it, which is a plain copy, and the parts of the view that it does not cover stay empty until it is redrawn.
+ */
+void Canvas::drawLayer(QPainter& painter, const QPixmap& layer, const cv::Point2f& origin, float scale) const {
+	QPointF corner = toScreen(origin);
+	if (scale == view_scale) {
+		painter.drawPixmap(qRound(corner.x()), qRound(corner.y()), layer);
+	}
+	else {
+		float ratio = view_scale / scale;
+		painter.drawPixmap(QRectF(corner.x(), corner.y(), layer.width() * ratio, layer.height() * ratio), layer, QRectF(layer.rect()));
+	}
+}
+
+/**
+ * Pan the view by dragging with the left or the middle button.
+ */
 void Canvas::mousePressEvent(QMouseEvent* e) {
+	if (e->button() == Qt::LeftButton || e->button() == Qt::MiddleButton) {
+		panning = true;
+		last_mouse_pos = e->pos();
+	}
+
 	update();
 }
 
-void Canvas::resizeEvent(QResizeEvent *e) {
-	if (!orig_image.isNull()) {
-		image_scale = std::min((float)width() / orig_image.width(), (float)height() / orig_image.height());
-		image = orig_image.scaled(orig_image.width() * image_scale, orig_image.height() * image_scale);
+void Canvas::mouseMoveEvent(QMouseEvent* e) {
+	if (!panning) return;
+
+	QPoint delta = e->pos() - last_mouse_pos;
+	last_mouse_pos = e->pos();
+	view_origin -= cv::Point2f(delta.x(), delta.y()) / view_scale;
+	fit_to_window = false;
+	scheduleRender();
+
+	update();
+}
+
+/**
+ * End a pan, drawing the layers at the new view right away rather than after RENDER_DELAY.
+ */
+void Canvas::mouseReleaseEvent(QMouseEvent* e) {
+	if (panning && render_timer.isActive()) {
+		invalidateLayers();
+		update();
 	}
+	panning = false;
 }
 
+/**
+ * Zoom in or out around the cursor with the mouse wheel.
+ */
+void Canvas::wheelEvent(QWheelEvent* e) {
+	if (orig_image.isNull()) return;
+
+	zoomAt(e->pos(), view_scale * std::pow(ZOOM_STEP, e->angleDelta().y() / 120.0f));
+}
+
+void Canvas::resizeEvent(QResizeEvent *e) {
+	if (fit_to_window) fitToWindow();
+	else invalidateLayers();
+}
+
+void Canvas::timerEvent(QTimerEvent* e) {
+	if (e->timerId() != render_timer.timerId()) {
+		QWidget::timerEvent(e);
+		return;
+	}
+
+	invalidateLayers();
+	update();
+}
@@ -4,10 +4,16 @@
 #include <vector>
 #include <QWidget>
 #include <QKeyEvent>
+#include <QPixmap>
+#include <QBasicTimer>
+#include <QPainter>
 #include "../CurveDetectionNoGUI/CurveDetector.h"
 #include "../CurveDetectionNoGUI/LineDetector.h"
 #include "../CurveDetectionNoGUI/MeanShift.h"
 #include "../CurveDetectionNoGUI/OrientationEstimator.h"
+#include "../CurveDetectionNoGUI/CenterlineExtractor.h"
+#include "DetectionWorker.h"
+#include "SpatialIndex.h"
 
 class Canvas : public QWidget {
 private:
@@ -15,12 +21,42 @@ private:
 
 private:
 	QImage orig_image;
-	QImage image;
-	float image_scale;
-	std::vector<Polygon> polygons;
+	std::vector<QImage> pyramid;	// orig_image halved at each level, to draw the background near the scale of the view
+	cv::Mat contour_buffer;
+	RunLengthImage binary_image;
+	PolygonSet polygons;
+	PolygonSet resampled;
+	float density;		// the points left per original point along the smooth runs by resampling
 	std::vector<Circle> circles;
 	std::vector<Line> lines;
 
+	// the view shows the image from view_origin, in image coordinates, at view_scale screen pixels per image pixel
+	float view_scale;
+	cv::Point2f view_origin;
+	bool fit_to_window;
+	bool panning;
+	QPoint last_mouse_pos;
+
+	// the rings, circles and lines by their bounding boxes, for drawing only the visible ones
+	SpatialIndex ring_index;
+	SpatialIndex circle_index;
+	SpatialIndex line_index;
+	bool rings_indexed;
+	int num_indexed_circles;
+	int num_indexed_lines;
+
+	// the contours and the primitives are drawn once into these layers, which are redrawn only when they change,
+	// along with the view that they were drawn at, so that they can be moved and scaled until the view settles
+	QPixmap contour_layer;
+	QPixmap primitive_layer;
+	bool contour_layer_valid;
+	bool primitive_layer_valid;
+	cv::Point2f contour_layer_origin;
+	float contour_layer_scale;
+	cv::Point2f primitive_layer_origin;
+	float primitive_layer_scale;
+	QBasicTimer render_timer;
+
 	bool ctrlPressed;
 	bool shiftPressed;
 	
@@ -29,15 +65,34 @@ public:
 
 	void loadImage(const QString& filename);
 	void detectContours();
-	void detectCurves(int num_iterations, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius);
-	void detectLines(int num_iterations, int min_points, float max_error, float cluster_epsilon, float min_length);
+	void detectCenterlines();
+	void resampleContours(float spacing);
+	float contourDensity() const { return density; }
+	const PolygonSet& beginDetection(const DetectionSettings& settings);
+	void addPrimitives(const std::vector<Circle>& new_circles, const std::vector<Line>& new_lines);
+	void endDetection(const DetectionWorker& worker);
+	void fitToWindow();
+	void zoomAt(const QPoint& pos, float scale);
 	void keyPressEvent(QKeyEvent* e);
 	void keyReleaseEvent(QKeyEvent* e);
 
 protected:
+	void invalidateIndex();
+	void updateIndex();
+	void invalidateLayers();
+	void scheduleRender();
+	cv::Rect2f visibleArea() const;
+	QPointF toScreen(const cv::Point2f& p) const;
+	void renderContourLayer();
+	void renderPrimitives(QPixmap& layer, const std::vector<int>& circle_ids, const std::vector<int>& line_ids);
+	void drawLayer(QPainter& painter, const QPixmap& layer, const cv::Point2f& origin, float scale) const;
 	void paintEvent(QPaintEvent *event);
 	void mousePressEvent(QMouseEvent* e);
+	void mouseMoveEvent(QMouseEvent* e);
+	void mouseReleaseEvent(QMouseEvent* e);
+	void wheelEvent(QWheelEvent* e);
 	void resizeEvent(QResizeEvent *e);
+	void timerEvent(QTimerEvent* e);
 };
 
 #endif // CANVAS_H
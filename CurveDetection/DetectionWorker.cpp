@@ -0,0 +1,103 @@
+#include "DetectionWorker.h"
+#include <algorithm>
+#include <cmath>
+#include "../CurveDetectionNoGUI/OrientationEstimator.h"
+#include "../CurveDetectionNoGUI/Tracer.h"
+
+namespace {
+
+// contours shorter than this are too small to hold a primitive
+const int MIN_CONTOUR_SIZE = 100;
+
+}
+
+DetectionWorker::DetectionWorker(const PolygonSet& polygons, const DetectionSettings& settings, QObject *parent) : QThread(parent), settings(settings), polygons(polygons), rng(0), num_polygons_done(0), num_circles(0), num_lines(0) {
+	min_contour_size = std::round(MIN_CONTOUR_SIZE * settings.density);
+	num_polygons = 0;
+	for (int i = 0; i < polygons.size(); i++) {
+		if (polygons.contourSize(i) >= min_contour_size) num_polygons++;
+	}
+	if (settings.detect_curves && settings.detect_lines) num_polygons *= 2;
+
+	// the primitives are collected as soon as the detectors accept them, to be drawn before the detection ends
+	control.on_circle = [this](const Circle& circle) {
+		std::lock_guard<std::mutex> lock(mutex);
+		new_circles.push_back(circle);
+	};
+	control.on_line = [this](const Line& line) {
+		std::lock_guard<std::mutex> lock(mutex);
+		new_lines.push_back(line);
+	};
+
+	progress_timer.setInterval(PROGRESS_INTERVAL);
+	connect(this, SIGNAL(started()), &progress_timer, SLOT(start()));
+	connect(this, SIGNAL(finished()), this, SLOT(onFinished()));
+	connect(&progress_timer, SIGNAL(timeout()), this, SLOT(onProgressTimer()));
+}
+
+void DetectionWorker::cancel() {
+	control.cancel();
+}
+
+void DetectionWorker::onProgressTimer() {
+	std::vector<Circle> circles;
+	std::vector<Line> lines;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		circles.swap(new_circles);
+		lines.swap(new_lines);
+	}
+	num_circles += circles.size();
+	num_lines += lines.size();
+	if (circles.size() > 0 || lines.size() > 0) emit detected(circles, lines);
+
+	emit progress(num_polygons_done.load(), num_polygons, control.numRounds(), control.numIterations());
+}
+
+void DetectionWorker::onFinished() {
+	progress_timer.stop();
+	onProgressTimer();
+}
+
+void DetectionWorker::run() {
+	// the curves go first, so that the lines are only searched among the points that no curve has used
+	if (settings.detect_curves) detectCurves();
+	if (settings.detect_lines) detectLines();
+}
+
+void DetectionWorker::detectCurves() {
+	for (int i = 0; i < polygons.size() && !control.isCancelled(); i++) {
+		if (polygons.contourSize(i) < min_contour_size) continue;
+
+		TraceScope trace("detectCircles", i);
+		std::vector<Circle> results;
+		CurveDetector::detect(polygons.contour(i), polygons.contourSize(i), polygons.isContourClosed(i), settings.curve_num_iterations, std::round(settings.curve_min_points * settings.density), settings.max_error_ratio_to_radius, std::max(1.0f, settings.curve_cluster_epsilon * settings.density), settings.min_angle, settings.min_radius, settings.max_radius, results, rng, NULL, &control);
+		num_polygons_done++;
+	}
+}
+
+void DetectionWorker::detectLines() {
+	std::vector<float> principal_orientations;
+	{
+		TraceScope trace("estimateOrientations");
+		std::vector<std::vector<cv::Point2f>> pgons;
+		for (int i = 0; i < polygons.size(); i++) {
+			if (polygons.contourSize(i) < min_contour_size) continue;
+
+			std::vector<cv::Point2f> pgon(polygons.contourSize(i));
+			for (int j = 0; j < pgon.size(); j++) pgon[j] = polygons.contour(i)[j].pos;
+			pgons.push_back(pgon);
+		}
+		principal_orientations = OrientationEstimator::estimatePeaks(pgons);
+	}
+
+	// detect lines based on the principal orientations
+	for (int i = 0; i < polygons.size() && !control.isCancelled(); i++) {
+		if (polygons.contourSize(i) < min_contour_size) continue;
+
+		TraceScope trace("detectLines", i);
+		std::vector<Line> results;
+		LineDetector::detect(polygons.contour(i), polygons.contourSize(i), polygons.isContourClosed(i), settings.line_num_iterations, std::round(settings.line_min_points * settings.density), settings.max_error, std::max(1.0f, settings.line_cluster_epsilon * settings.density), settings.min_length, principal_orientations, results, rng, NULL, &control);
+		num_polygons_done++;
+	}
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <QThread>
+#include <QTimer>
+#include "../CurveDetectionNoGUI/CurveDetector.h"
+#include "../CurveDetectionNoGUI/LineDetector.h"
+#include "../CurveDetectionNoGUI/DetectionControl.h"
+
+/**
+ * Which detectors to run and their arguments, as entered in the option dialogs. min_angle is in radians.
+ * The point counts and index distances apply to contours at full density, and are scaled by density, the points
+ * left per original point along the smooth runs by resampling, when the detectors run.
+ */
+class DetectionSettings {
+public:
+	bool detect_curves;
+	int curve_num_iterations;
+	int curve_min_points;
+	float max_error_ratio_to_radius;
+	float curve_cluster_epsilon;
+	float min_angle;
+	float min_radius;
+	float max_radius;
+	bool detect_lines;
+	int line_num_iterations;
+	int line_min_points;
+	float max_error;
+	float line_cluster_epsilon;
+	float min_length;
+	float density;
+
+public:
+	DetectionSettings() : detect_curves(false), detect_lines(false), density(1) {}
+};
+
+/**
+ * Runs the detectors over a copy of the polygons of the canvas on its own thread, so that the window stays
+ * responsive. While it runs, it reports the polygons done and the rounds and iterations of the detectors with
+ * progress() every PROGRESS_INTERVAL milliseconds, along with the primitives accepted since the last report with
+ * detected(), and cancel() makes it stop with the primitives found so far. Both signals are emitted on the thread
+ * that created the worker, and once finished() is emitted, every primitive has been reported. The detectors sample
+ * from a generator with a fixed seed, so that the same detection on the same polygons finds the same primitives.
+ */
+class DetectionWorker : public QThread {
+	Q_OBJECT
+
+public:
+	static const int PROGRESS_INTERVAL = 100;
+
+private:
+	DetectionSettings settings;
+	PolygonSet polygons;
+	DetectionControl control;
+	cv::RNG rng;
+	int num_polygons;
+	std::atomic<int> num_polygons_done;
+	QTimer progress_timer;
+	int min_contour_size;
+
+	// the primitives accepted on the worker thread that have not been reported yet
+	std::mutex mutex;
+	std::vector<Circle> new_circles;
+	std::vector<Line> new_lines;
+	int num_circles;
+	int num_lines;
+
+public:
+	DetectionWorker(const PolygonSet& polygons, const DetectionSettings& settings, QObject *parent = Q_NULLPTR);
+
+	void cancel();
+	bool isCancelled() const { return control.isCancelled(); }
+	const DetectionSettings& getSettings() const { return settings; }
+	const PolygonSet& getPolygons() const { return polygons; }
+	int numCircles() const { return num_circles; }
+	int numLines() const { return num_lines; }
+
+signals:
+	void detected(const std::vector<Circle>& circles, const std::vector<Line>& lines);
+	void progress(int polygons_done, int num_polygons, qint64 rounds, qint64 iterations);
+
+public slots:
+	void onProgressTimer();
+	void onFinished();
+
+protected:
+	void run();
+	void detectCurves();
+	void detectLines();
+};
@@ -29,6 +29,8 @@ public:
     QAction *actionExit;
     QAction *actionOpen;
     QAction *actionDetectContours;
+    QAction *actionDetectCenterlines;
+    QAction *actionResampleContours;
     QAction *actionDetectCurves;
     QAction *actionDetectLines;
     QAction *actionDetectCurvesLines;
@@ -50,6 +52,10 @@ public:
         actionOpen->setObjectName(QStringLiteral("actionOpen"));
         actionDetectContours = new QAction(MainWindowClass);
         actionDetectContours->setObjectName(QStringLiteral("actionDetectContours"));
+        actionDetectCenterlines = new QAction(MainWindowClass);
+        actionDetectCenterlines->setObjectName(QStringLiteral("actionDetectCenterlines"));
+        actionResampleContours = new QAction(MainWindowClass);
+        actionResampleContours->setObjectName(QStringLiteral("actionResampleContours"));
         actionDetectCurves = new QAction(MainWindowClass);
         actionDetectCurves->setObjectName(QStringLiteral("actionDetectCurves"));
         actionDetectLines = new QAction(MainWindowClass);
@@ -80,6 +86,8 @@ public:
         menuFile->addSeparator();
         menuFile->addAction(actionExit);
         menuTool->addAction(actionDetectContours);
+        menuTool->addAction(actionDetectCenterlines);
+        menuTool->addAction(actionResampleContours);
         menuTool->addAction(actionDetectCurves);
         menuTool->addAction(actionDetectLines);
         menuTool->addAction(actionDetectCurvesLines);
@@ -96,6 +104,8 @@ public:
         actionOpen->setText(QApplication::translate("MainWindowClass", "Open", Q_NULLPTR));
         actionOpen->setShortcut(QApplication::translate("MainWindowClass", "Ctrl+O", Q_NULLPTR));
         actionDetectContours->setText(QApplication::translate("MainWindowClass", "Detect Contours", Q_NULLPTR));
+        actionDetectCenterlines->setText(QApplication::translate("MainWindowClass", "Detect Centerlines", Q_NULLPTR));
+        actionResampleContours->setText(QApplication::translate("MainWindowClass", "Resample Contours...", Q_NULLPTR));
         actionDetectCurves->setText(QApplication::translate("MainWindowClass", "Detect Curves", Q_NULLPTR));
         actionDetectLines->setText(QApplication::translate("MainWindowClass", "Detect Lines", Q_NULLPTR));
         actionDetectCurvesLines->setText(QApplication::translate("MainWindowClass", "Detect Curves/Lines", Q_NULLPTR));
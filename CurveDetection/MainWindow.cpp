@@ -1,5 +1,7 @@
 #include "MainWindow.h"
 #include <QFileDialog>
+#include <QInputDialog>
+#include <algorithm>
 #include "CurveOptionDialog.h"
 #include "LineOptionDialog.h"
 #include "CurveLineOptionDialog.h"
@@ -9,50 +11,198 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
 	setCentralWidget(&canvas);
 
+	// the progress of a running detection is shown in the status bar
+	worker = NULL;
+	progress_label = new QLabel(this);
+	progress_bar = new QProgressBar(this);
+	progress_bar->setMaximumWidth(200);
+	cancel_button = new QPushButton(tr("Cancel"), this);
+	ui.statusBar->addPermanentWidget(progress_label);
+	ui.statusBar->addPermanentWidget(progress_bar);
+	ui.statusBar->addPermanentWidget(cancel_button);
+	progress_label->hide();
+	progress_bar->hide();
+	cancel_button->hide();
+	connect(cancel_button, SIGNAL(clicked()), this, SLOT(onCancelDetection()));
+
 	connect(ui.actionOpen, SIGNAL(triggered()), this, SLOT(onOpen()));
 	connect(ui.actionExit, SIGNAL(triggered()), this, SLOT(close()));
 	connect(ui.actionDetectContours, SIGNAL(triggered()), this, SLOT(onDetectContours()));
+	connect(ui.actionDetectCenterlines, SIGNAL(triggered()), this, SLOT(onDetectCenterlines()));
+	connect(ui.actionResampleContours, SIGNAL(triggered()), this, SLOT(onResampleContours()));
 	connect(ui.actionDetectCurves, SIGNAL(triggered()), this, SLOT(onDetectCurves()));
 	connect(ui.actionDetectLines, SIGNAL(triggered()), this, SLOT(onDetectLines()));
 	connect(ui.actionDetectCurvesLines, SIGNAL(triggered()), this, SLOT(onDetectCurvesLines()));
 }
 
+MainWindow::~MainWindow() {
+	stopDetection();
+}
+
+/**
+ * Run the detectors on a worker thread over the polygons of the canvas, which gets the results when it finishes.
+ * A detection that is still running is abandoned first, and the settings are scaled to resampled polygons.
+ */
+void MainWindow::startDetection(DetectionSettings settings) {
+	stopDetection();
+
+	const PolygonSet& polygons = canvas.beginDetection(settings);
+	settings.density = canvas.contourDensity();
+	worker = new DetectionWorker(polygons, settings, this);
+	connect(worker, SIGNAL(progress(int, int, qint64, qint64)), this, SLOT(onDetectionProgress(int, int, qint64, qint64)));
+	connect(worker, SIGNAL(detected(const std::vector<Circle>&, const std::vector<Line>&)), this, SLOT(onDetected(const std::vector<Circle>&, const std::vector<Line>&)));
+	connect(worker, SIGNAL(finished()), this, SLOT(onDetectionFinished()));
+
+	progress_label->setText(tr("Detecting..."));
+	progress_bar->setValue(0);
+	progress_label->show();
+	progress_bar->show();
+	cancel_button->setEnabled(true);
+	cancel_button->show();
+	canvas.update();
+
+	worker->start();
+}
+
+/**
+ * Cancel the running detection, if any, and wait for its thread to end. The primitives it has found stay on the
+ * canvas as after a cancellation with the button, so the canvas also gets the rest of them and the polygons whose
+ * points they have taken.
+ */
+void MainWindow::stopDetection() {
+	if (worker == NULL) return;
+
+	disconnect(worker, SIGNAL(progress(int, int, qint64, qint64)), this, SLOT(onDetectionProgress(int, int, qint64, qint64)));
+	disconnect(worker, SIGNAL(finished()), this, SLOT(onDetectionFinished()));
+	worker->cancel();
+	worker->wait();
+
+	// report the primitives accepted since the last progress, which the deleted worker would no longer do
+	worker->onFinished();
+	canvas.endDetection(*worker);
+	delete worker;
+	worker = NULL;
+
+	progress_label->hide();
+	progress_bar->hide();
+	cancel_button->hide();
+}
+
 void MainWindow::onOpen() {
 	QString filename = QFileDialog::getOpenFileName(this, tr("Load voxel data..."), "", tr("Image files (*.png *.jpg *.bmp)"));
 	if (filename.isEmpty()) return;
 
 	setWindowTitle("Line/Curve Detection - " + filename);
 	
+	stopDetection();
 	canvas.loadImage(filename);
 	canvas.update();
 }
 
 void MainWindow::onDetectContours() {
+	stopDetection();
 	canvas.detectContours();
 	canvas.update();
 }
 
+void MainWindow::onDetectCenterlines() {
+	stopDetection();
+	canvas.detectCenterlines();
+	canvas.update();
+}
+
+void MainWindow::onResampleContours() {
+	bool ok;
+	double spacing = QInputDialog::getDouble(this, tr("Resample Contours"), tr("Spacing between points (pixels):"), 3, 1, 100, 1, &ok);
+	if (!ok) return;
+
+	stopDetection();
+	canvas.resampleContours(spacing);
+	canvas.update();
+}
+
 void MainWindow::onDetectCurves() {
 	CurveOptionDialog dlg;
 	if (dlg.exec()) {
-		canvas.detectCurves(dlg.getNumIterations(), dlg.getMinPoints(), dlg.getMaxErrorRatioToRadius(), dlg.getClusterEpsilon(), dlg.getMinAngle() / 180.0 * CV_PI, dlg.getMinRadius(), dlg.getMaxRadius());
-		canvas.update();
+		DetectionSettings settings;
+		settings.detect_curves = true;
+		settings.curve_num_iterations = dlg.getNumIterations();
+		settings.curve_min_points = dlg.getMinPoints();
+		settings.max_error_ratio_to_radius = dlg.getMaxErrorRatioToRadius();
+		settings.curve_cluster_epsilon = dlg.getClusterEpsilon();
+		settings.min_angle = dlg.getMinAngle() / 180.0 * CV_PI;
+		settings.min_radius = dlg.getMinRadius();
+		settings.max_radius = dlg.getMaxRadius();
+		startDetection(settings);
 	}
 }
 
 void MainWindow::onDetectLines() {
 	LineOptionDialog dlg;
 	if (dlg.exec()) {
-		canvas.detectLines(dlg.getNumIterations(), dlg.getMinPoints(), dlg.getMaxError(), dlg.getClusterEpsilon(), dlg.getMinLength());
-		canvas.update();
+		DetectionSettings settings;
+		settings.detect_lines = true;
+		settings.line_num_iterations = dlg.getNumIterations();
+		settings.line_min_points = dlg.getMinPoints();
+		settings.max_error = dlg.getMaxError();
+		settings.line_cluster_epsilon = dlg.getClusterEpsilon();
+		settings.min_length = dlg.getMinLength();
+		startDetection(settings);
 	}
 }
 
 void MainWindow::onDetectCurvesLines() {
 	CurveLineOptionDialog dlg;
 	if (dlg.exec()) {
-		canvas.detectCurves(dlg.getCurveNumIterations(), dlg.getCurveMinPoints(), dlg.getCurveMaxErrorRatioToRadius(), dlg.getCurveClusterEpsilon(), dlg.getCurveMinAngle() / 180.0 * CV_PI, dlg.getCurveMinRadius(), dlg.getCurveMaxRadius());
-		canvas.detectLines(dlg.getLineNumIterations(), dlg.getLineMinPoints(), dlg.getLineMaxError(), dlg.getLineClusterEpsilon(), dlg.getLineMinLength());
-		canvas.update();
+		DetectionSettings settings;
+		settings.detect_curves = true;
+		settings.curve_num_iterations = dlg.getCurveNumIterations();
+		settings.curve_min_points = dlg.getCurveMinPoints();
+		settings.max_error_ratio_to_radius = dlg.getCurveMaxErrorRatioToRadius();
+		settings.curve_cluster_epsilon = dlg.getCurveClusterEpsilon();
+		settings.min_angle = dlg.getCurveMinAngle() / 180.0 * CV_PI;
+		settings.min_radius = dlg.getCurveMinRadius();
+		settings.max_radius = dlg.getCurveMaxRadius();
+		settings.detect_lines = true;
+		settings.line_num_iterations = dlg.getLineNumIterations();
+		settings.line_min_points = dlg.getLineMinPoints();
+		settings.max_error = dlg.getLineMaxError();
+		settings.line_cluster_epsilon = dlg.getLineClusterEpsilon();
+		settings.min_length = dlg.getLineMinLength();
+		startDetection(settings);
 	}
+}
+
+void MainWindow::onDetectionProgress(int polygons_done, int num_polygons, qint64 rounds, qint64 iterations) {
+	progress_bar->setMaximum(std::max(num_polygons, 1));
+	progress_bar->setValue(polygons_done);
+	progress_label->setText(tr("Polygons: %1/%2, rounds: %3, iterations: %4").arg(polygons_done).arg(num_polygons).arg(rounds).arg(iterations));
+}
+
+void MainWindow::onDetected(const std::vector<Circle>& circles, const std::vector<Line>& lines) {
+	canvas.addPrimitives(circles, lines);
+}
+
+/**
+ * Hand the polygons to the canvas, which has all the primitives by now, or the ones found before a cancellation.
+ */
+void MainWindow::onDetectionFinished() {
+	canvas.endDetection(*worker);
+
+	progress_label->hide();
+	progress_bar->hide();
+	cancel_button->hide();
+	QString message = worker->isCancelled() ? tr("Detection cancelled: %1 curves, %2 lines") : tr("Detected %1 curves, %2 lines");
+	ui.statusBar->showMessage(message.arg(worker->numCircles()).arg(worker->numLines()), 5000);
+
+	worker->deleteLater();
+	worker = NULL;
+}
+
+void MainWindow::onCancelDetection() {
+	if (worker == NULL) return;
+
+	worker->cancel();
+	cancel_button->setEnabled(false);
+	progress_label->setText(tr("Cancelling..."));
 }
\ No newline at end of file
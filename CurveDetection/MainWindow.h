@@ -1,8 +1,12 @@
 #pragma once
 
 #include <QtWidgets/QMainWindow>
+#include <QProgressBar>
+#include <QLabel>
+#include <QPushButton>
 #include "ui_MainWindow.h"
 #include "Canvas.h"
+#include "DetectionWorker.h"
 
 class MainWindow : public QMainWindow {
 	Q_OBJECT
@@ -10,14 +14,30 @@ class MainWindow : public QMainWindow {
 private:
 	Ui::MainWindowClass ui;
 	Canvas canvas;
+	DetectionWorker* worker;
+	QProgressBar* progress_bar;
+	QLabel* progress_label;
+	QPushButton* cancel_button;
 
 public:
 	MainWindow(QWidget *parent = Q_NULLPTR);
+	~MainWindow();
+
+private:
+	void startDetection(DetectionSettings settings);
+	void stopDetection();
 
 public slots:
 	void onOpen();
 	void onDetectContours();
+	void onDetectCenterlines();
+	void onResampleContours();
 	void onDetectCurves();
 	void onDetectLines();
 	void onDetectCurvesLines();
+	void onDetectionProgress(int polygons_done, int num_polygons, qint64 rounds, qint64 iterations);
+	void onDetected(const std::vector<Circle>& circles, const std::vector<Line>& lines);
+	void onDetectionFinished();
+	void onCancelDetection();
 };
+
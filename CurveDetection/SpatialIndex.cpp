@@ -0,0 +1,68 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// the number of cells that the grid aims for, whatever the size of the image
+const int TARGET_NUM_CELLS = 4096;
+const float MIN_CELL_SIZE = 32;
+
+}
+
+/**
+ * Remove all the items and size the grid for an image, with cells large enough that a small item does not span
+ * many of them, and small enough that a zoomed-in view only touches a few.
+ */
+void SpatialIndex::reset(int width, int height) {
+	cell_size = std::max(MIN_CELL_SIZE, std::sqrt((float)width * height / TARGET_NUM_CELLS));
+	cols = std::max(1, (int)std::ceil(width / cell_size));
+	rows = std::max(1, (int)std::ceil(height / cell_size));
+	cells.assign(cols * rows, std::vector<int>());
+	num_items = 0;
+	marks.clear();
+	query_count = 0;
+}
+
+void SpatialIndex::insert(int id, const cv::Rect2f& bounds) {
+	int col1, row1, col2, row2;
+	cellRange(bounds, col1, row1, col2, row2);
+	for (int r = row1; r <= row2; r++) {
+		for (int c = col1; c <= col2; c++) cells[r * cols + c].push_back(id);
+	}
+
+	num_items = std::max(num_items, id + 1);
+}
+
+/**
+ * Return the items whose bounding boxes may overlap the area, each once and in ascending order, so that they are
+ * drawn in the order in which they were found.
+ */
+void SpatialIndex::query(const cv::Rect2f& area, std::vector<int>& ids) {
+	ids.clear();
+	if (cells.empty()) return;
+
+	if ((int)marks.size() < num_items) marks.resize(num_items, 0);
+	query_count++;
+
+	int col1, row1, col2, row2;
+	cellRange(area, col1, row1, col2, row2);
+	for (int r = row1; r <= row2; r++) {
+		for (int c = col1; c <= col2; c++) {
+			for (int id : cells[r * cols + c]) {
+				if (marks[id] == query_count) continue;
+				marks[id] = query_count;
+				ids.push_back(id);
+			}
+		}
+	}
+
+	std::sort(ids.begin(), ids.end());
+}
+
+void SpatialIndex::cellRange(const cv::Rect2f& bounds, int& col1, int& row1, int& col2, int& row2) const {
+	col1 = std::min(std::max((int)std::floor(bounds.x / cell_size), 0), cols - 1);
+	row1 = std::min(std::max((int)std::floor(bounds.y / cell_size), 0), rows - 1);
+	col2 = std::min(std::max((int)std::floor((bounds.x + bounds.width) / cell_size), 0), cols - 1);
+	row2 = std::min(std::max((int)std::floor((bounds.y + bounds.height) / cell_size), 0), rows - 1);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * Uniform grid over an image that finds the items whose bounding boxes overlap an area, so that only the visible
+ * items of a large drawing need to be drawn. Each item is listed in every cell that its bounding box overlaps, and
+ * the parts of the boxes outside the image fall into the border cells.
+ */
+class SpatialIndex {
+private:
+	float cell_size;
+	int cols;
+	int rows;
+	std::vector<std::vector<int>> cells;
+	int num_items;
+
+	// the items already found by the current query, marked with its number, so that each is returned once
+	std::vector<int> marks;
+	int query_count;
+
+public:
+	SpatialIndex() : cell_size(1), cols(0), rows(0), num_items(0), query_count(0) {}
+
+	void reset(int width, int height);
+	int size() const { return num_items; }
+	void insert(int id, const cv::Rect2f& bounds);
+	void query(const cv::Rect2f& area, std::vector<int>& ids);
+
+private:
+	void cellRange(const cv::Rect2f& bounds, int& col1, int& row1, int& col2, int& row2) const;
+};
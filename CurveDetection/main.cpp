@@ -1,5 +1,7 @@
 #include "MainWindow.h"
 #include <QtWidgets/QApplication>
+#include <iostream>
+#include "../CurveDetectionNoGUI/Tracer.h"
 
 int main(int argc, char *argv[])
 {
@@ -7,8 +9,21 @@ int main(int argc, char *argv[])
 	std::vector<float> angles = { 0.05f, 0.8f, 1.5f, 1.6f, 2.3f, 3.1f, 5.4f, 5.5f, 6.2f };
 	std::vector<float> ret = MeanShift::cluster(angles, 0.2, 0.2, 5, 0.2);
 
+	// record the timings of the session with --trace <trace.json>
+	std::string trace_path;
+	for (int i = 1; i + 1 < argc; i++) {
+		if (std::string(argv[i]) == "--trace") trace_path = argv[i + 1];
+	}
+	if (!trace_path.empty()) Tracer::start();
+
 	QApplication a(argc, argv);
 	MainWindow w;
 	w.show();
-	return a.exec();
+	int status = a.exec();
+
+	if (!trace_path.empty() && !Tracer::write(trace_path)) {
+		std::cerr << "Cannot write " << trace_path << std::endl;
+	}
+
+	return status;
 }
@@ -0,0 +1,433 @@
+#include <iostream>
+#include <fstream>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <opencv2/imgcodecs.hpp>
+#include "../CurveDetectionNoGUI/Pipeline.h"
+#include "../CurveDetectionNoGUI/OrientationEstimator.h"
+#include "../CurveDetectionNoGUI/MeanShift.h"
+#include "../CurveDetectionNoGUI/Tracer.h"
+#include "Evaluation.h"
+
+namespace {
+
+/**
+ * Timings of one benchmark. The result is a checksum of what the benchmark computed, such as the number of circles
+ * found, so that a change of speed can be told apart from a change of behavior when two runs are compared.
+ * The allocations are those of one repetition, which are only counted with allocation tracking compiled in.
+ */
+class Result {
+public:
+	std::string name;
+	int64_t iterations;
+	std::vector<double> times_ms;
+	double result;
+	AllocationCount allocations;
+
+public:
+	double min() const { return *std::min_element(times_ms.begin(), times_ms.end()); }
+	double mean() const { return std::accumulate(times_ms.begin(), times_ms.end(), 0.0) / times_ms.size(); }
+	double median() const {
+		std::vector<double> sorted = times_ms;
+		std::sort(sorted.begin(), sorted.end());
+		return sorted.size() % 2 == 1 ? sorted[sorted.size() / 2] : (sorted[sorted.size() / 2 - 1] + sorted[sorted.size() / 2]) * 0.5;
+	}
+};
+
+/**
+ * Run the body once to warm up the caches and the allocator, and then time it repetitions times. The body has to
+ * reseed everything it samples, so that every repetition does the same work.
+ */
+Result measure(const std::string& name, int64_t iterations, int repetitions, const std::function<double()>& body) {
+	Result result;
+	result.name = name;
+	result.iterations = iterations;
+	result.result = body();
+	for (int i = 0; i < repetitions; i++) {
+		AllocationCount begin_allocations = Tracer::allocations();
+		int64_t begin = Tracer::now();
+		body();
+		result.times_ms.push_back((Tracer::now() - begin) / 1000.0);
+		result.allocations.allocations = Tracer::allocations().allocations - begin_allocations.allocations;
+		result.allocations.bytes = Tracer::allocations().bytes - begin_allocations.bytes;
+	}
+	std::cerr << name << ": " << result.median() << " ms" << std::endl;
+
+	return result;
+}
+
+/**
+ * Trace the contours of the drawing, and keep the ones that the pipeline would run the detectors on.
+ */
+bool loadContours(const std::string& path, PolygonSet& polygons) {
+	cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE);
+	if (image.empty()) return false;
+
+	RunLengthImage binary_image;
+	binary_image.create(ImageView(image.data, image.cols, image.rows, image.step));
+	findContours(binary_image, polygons, 100);
+
+	return polygons.size() > 0;
+}
+
+/**
+ * Accuracy and cost of one configuration over the labelled images. The hypotheses are only counted when the
+ * detectors are compiled with CURVE_DETECTION_STATS defined.
+ */
+class ConfigResult {
+public:
+	double detect_ms;
+	int64_t hypotheses;
+	Score circles;
+	Score lines;
+	bool pareto;
+
+public:
+	ConfigResult() : detect_ms(0), hypotheses(0), pareto(false) {}
+
+	Score total(bool with_lines) const {
+		Score score = circles;
+		if (with_lines) score.add(lines);
+		return score;
+	}
+};
+
+/**
+ * Run every configuration on the contours of every labelled image, timing only the detectors, and score the
+ * detections against the ground truth next to the image. Return the number of images that were evaluated.
+ */
+int evaluate(const Pipeline& pipeline, const std::vector<std::string>& inputs, const std::vector<Parameters>& configs, const Tolerances& tolerances, std::vector<ConfigResult>& results) {
+	results.assign(configs.size(), ConfigResult());
+	int num_evaluated = 0;
+	Workspace workspace;
+	std::vector<Point> buffer;
+	for (auto& input : inputs) {
+		GroundTruth truth;
+		if (!truth.load(GroundTruth::pathOf(input))) {
+			std::cerr << "No ground truth for " << input << std::endl;
+			continue;
+		}
+		Job job(input, "");
+		if (!pipeline.prepare(job, &workspace)) {
+			std::cerr << "Cannot read " << input << std::endl;
+			continue;
+		}
+		num_evaluated++;
+
+		const PolygonSet& contours = pipeline.resample_spacing > 1 ? job.resampled : job.polygons;
+		std::vector<float> principal_orientations = pipeline.principalOrientations(contours);
+		for (int k = 0; k < configs.size(); k++) {
+			std::vector<Circle> circles, all_circles;
+			std::vector<Line> lines, all_lines;
+			DetectorStats circle_stats, line_stats;
+
+			int64_t begin = Tracer::now();
+			for (int i = 0; i < contours.size(); i++) {
+				pipeline.detectPolygon(job, i, configs[k], principal_orientations, buffer, circles, lines, &circle_stats, &line_stats);
+				all_circles.insert(all_circles.end(), circles.begin(), circles.end());
+				all_lines.insert(all_lines.end(), lines.begin(), lines.end());
+			}
+			results[k].detect_ms += (Tracer::now() - begin) / 1000.0;
+			results[k].hypotheses += circle_stats.hypotheses + line_stats.hypotheses;
+
+			results[k].circles.add(Evaluator::scoreCircles(truth.circles, all_circles, tolerances));
+			if (pipeline.detect_lines) results[k].lines.add(Evaluator::scoreLines(truth.lines, all_lines, tolerances));
+		}
+	}
+
+	return num_evaluated;
+}
+
+/**
+ * Mark the configurations that no other one beats in detection time, precision and recall at once.
+ */
+void markParetoFrontier(std::vector<ConfigResult>& results, bool with_lines) {
+	for (int k = 0; k < results.size(); k++) {
+		Score score = results[k].total(with_lines);
+		results[k].pareto = true;
+		for (int j = 0; j < results.size() && results[k].pareto; j++) {
+			Score other = results[j].total(with_lines);
+			bool no_worse = results[j].detect_ms <= results[k].detect_ms && other.precision() >= score.precision() && other.recall() >= score.recall();
+			bool better = results[j].detect_ms < results[k].detect_ms || other.precision() > score.precision() || other.recall() > score.recall();
+			if (j != k && no_worse && better) results[k].pareto = false;
+		}
+	}
+}
+
+}
+
+/**
+ * Benchmark the building blocks of the detectors in isolation, on the contours of one drawing, and the whole
+ * pipeline on each of the bundled drawings. The random numbers of the inputs and of the detectors come from fixed
+ * seeds, and the results are written as JSON, so that the runs of two commits can be compared.
+ *
+ * With --pareto, the configurations of a parameter grid are instead scored on labelled images, such as the ones
+ * of CurveDetectionGenerator, and the configurations on the Pareto frontier of detection time, precision and
+ * recall are marked, so that a faster configuration or detector can be accepted on its measured accuracy.
+ */
+int main(int argc, char *argv[]) {
+	Pipeline pipeline;
+	pipeline.render = false;
+	std::string images = "../CurveDetection";
+	std::string output_path;
+	std::string filter;
+	std::string pareto_grid;
+	std::string labelled;
+	Tolerances tolerances;
+	int repetitions = 5;
+	unsigned int seed = 1;
+	bool valid = true;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--images" && i + 1 < argc) images = argv[++i];
+		else if (arg == "--out" && i + 1 < argc) output_path = argv[++i];
+		else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+		else if (arg == "--repetitions" && i + 1 < argc) repetitions = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--seed" && i + 1 < argc) seed = std::strtoul(argv[++i], NULL, 10);
+		else if (arg == "--pareto" && i + 1 < argc) pareto_grid = argv[++i];
+		else if (arg == "--lines") pipeline.detect_lines = true;
+		else if (arg == "--centerline") pipeline.centerline = true;
+		else if (arg == "--resample" && i + 1 < argc) pipeline.resample_spacing = std::atof(argv[++i]);
+		else if (arg == "--tolerance" && i + 1 < argc) tolerances.distance = std::atof(argv[++i]);
+		else if (arg == "--coverage" && i + 1 < argc) tolerances.min_coverage = std::atof(argv[++i]);
+		else if (labelled.empty() && arg[0] != '-') labelled = arg;
+		else valid = false;
+	}
+	if (!valid || pareto_grid.empty() != labelled.empty()) {
+		std::cout << "Usage: " << argv[0] << " [--images <directory>] [--out <results.json>] [--filter <substring>] [--repetitions <n>] [--seed <n>]" << std::endl;
+		std::cout << "       " << argv[0] << " --pareto <grid|grid file> [--lines] [--centerline] [--resample <spacing>] [--tolerance <pixels>] [--coverage <ratio>] [--out <results.json>] [--seed <n>] <labelled directory|glob|manifest>" << std::endl;
+		return -1;
+	}
+	pipeline.seed = seed;
+
+	std::ofstream file;
+	if (!output_path.empty()) {
+		file.open(output_path);
+		if (!file) {
+			std::cerr << "Cannot write " << output_path << std::endl;
+			return -1;
+		}
+	}
+	std::ostream& out = output_path.empty() ? std::cout : file;
+
+	if (!pareto_grid.empty()) {
+		std::vector<Parameters> configs;
+		if (!Parameters::grid(pareto_grid, pipeline.params, configs)) return -1;
+
+		std::vector<ConfigResult> results;
+		int num_evaluated = evaluate(pipeline, Pipeline::listInputs(labelled), configs, tolerances, results);
+		if (num_evaluated == 0) {
+			std::cerr << "No labelled images in " << labelled << std::endl;
+			return -1;
+		}
+		markParetoFrontier(results, pipeline.detect_lines);
+
+		out << "{\"seed\":" << seed << ",\"images\":" << num_evaluated << ",\"stats\":" << (DetectorStats::enabled() ? "true" : "false")
+			<< ",\"tolerance\":" << tolerances.distance << ",\"coverage\":" << tolerances.min_coverage << ",\"configs\":[";
+		for (int k = 0; k < results.size(); k++) {
+			const ConfigResult& r = results[k];
+			Score total = r.total(pipeline.detect_lines);
+			out << (k > 0 ? "," : "") << "\n{\"config\":" << k << ",\"params\":" << configs[k].toJson() << ",\"detect_ms\":" << r.detect_ms
+				<< ",\"hypotheses\":" << r.hypotheses << ",\"precision\":" << total.precision() << ",\"recall\":" << total.recall()
+				<< ",\"circles\":" << r.circles.toJson();
+			if (pipeline.detect_lines) out << ",\"lines\":" << r.lines.toJson();
+			out << ",\"pareto\":" << (r.pareto ? "true" : "false") << "}";
+
+			if (r.pareto) std::cerr << "config " << k << " " << configs[k].toJson() << ": " << r.detect_ms << " ms, precision " << total.precision() << ", recall " << total.recall() << std::endl;
+		}
+		out << "\n]}" << std::endl;
+
+		return 0;
+	}
+
+	// the drawings D*.png and test.png that come with the GUI
+	std::vector<std::string> inputs = Pipeline::listInputs(images + "/D*.png");
+	std::vector<std::string> test_inputs = Pipeline::listInputs(images + "/test.png");
+	inputs.insert(inputs.end(), test_inputs.begin(), test_inputs.end());
+	if (inputs.empty()) {
+		std::cerr << "No drawings in " << images << std::endl;
+		return -1;
+	}
+
+	PolygonSet polygons;
+	if (!loadContours(inputs[0], polygons)) {
+		std::cerr << "No contours in " << inputs[0] << std::endl;
+		return -1;
+	}
+	Parameters params;
+
+	auto selected = [&](const std::string& name) {
+		return filter.empty() || name.find(filter) != std::string::npos;
+	};
+	std::vector<Result> results;
+
+	// triples of nearby contour points, as the circle detector samples them
+	const int num_triples = 1000000;
+	std::vector<cv::Point2f> triples(num_triples * 3);
+	std::vector<std::pair<int, int>> first_points(num_triples);
+	{
+		cv::RNG rng(seed);
+		for (int i = 0; i < num_triples; i++) {
+			int c = rng.uniform(0, polygons.size());
+			int N = polygons.contourSize(c);
+			int index1 = rng.uniform(0, N);
+			first_points[i] = std::make_pair(c, index1);
+			triples[i * 3] = polygons.contour(c)[index1].pos;
+			triples[i * 3 + 1] = polygons.contour(c)[(index1 + rng.uniform(1, (int)params.cluster_epsilon + 1)) % N].pos;
+			triples[i * 3 + 2] = polygons.contour(c)[(index1 + N - rng.uniform(1, (int)params.cluster_epsilon + 1)) % N].pos;
+		}
+	}
+
+	if (selected("circleFromPoints")) {
+		results.push_back(measure("circleFromPoints", num_triples, repetitions, [&]() {
+			double sum = 0;
+			for (int i = 0; i < num_triples; i++) {
+				Circle circle = CurveDetector::circleFromPoints(triples[i * 3], triples[i * 3 + 1], triples[i * 3 + 2]);
+				if (circle.radius >= params.min_radius && circle.radius <= params.max_radius) sum += 1;
+			}
+			return sum;
+		}));
+	}
+
+	// the support walk of CurveDetector::detect from the first point of each candidate
+	if (selected("supportWalk")) {
+		const int num_candidates = 20000;
+		std::vector<std::pair<int, int>> candidates;
+		std::vector<Circle> circles;
+		for (int i = 0; i < num_triples && candidates.size() < num_candidates; i++) {
+			Circle circle = CurveDetector::circleFromPoints(triples[i * 3], triples[i * 3 + 1], triples[i * 3 + 2]);
+			if (circle.radius < params.min_radius || circle.radius > params.max_radius) continue;
+			candidates.push_back(first_points[i]);
+			circles.push_back(circle);
+		}
+
+		results.push_back(measure("supportWalk", candidates.size(), repetitions, [&]() {
+			double sum = 0;
+			std::vector<float> angles;
+			for (int k = 0; k < candidates.size(); k++) {
+				int c = candidates[k].first;
+				sum += CurveDetector::walkSupport(polygons.contour(c), polygons.contourSize(c), polygons.isContourClosed(c), candidates[k].second, params.max_error_ratio_to_radius, params.cluster_epsilon, circles[k], angles);
+			}
+			return sum;
+		}));
+	}
+
+	std::vector<std::vector<cv::Point2f>> pgons(polygons.size());
+	for (int i = 0; i < polygons.size(); i++) {
+		for (int j = 0; j < polygons.contourSize(i); j++) pgons[i].push_back(polygons.contour(i)[j].pos);
+	}
+
+	if (selected("houghVoting")) {
+		results.push_back(measure("houghVoting", polygons.points.size(), repetitions, [&]() {
+			std::vector<float> peaks = OrientationEstimator::estimatePeaks(pgons);
+			return peaks.empty() ? -1.0 : peaks[0];
+		}));
+	}
+
+	// angles scattered around four orientations, as the line directions of a drawing are
+	if (selected("meanShift")) {
+		const int num_angles = 5000;
+		std::vector<float> angles(num_angles);
+		cv::RNG rng(seed);
+		for (int i = 0; i < num_angles; i++) {
+			angles[i] = (float)(rng.uniform(0, 4) * CV_PI / 4 + rng.gaussian(0.05));
+		}
+
+		results.push_back(measure("meanShift", num_angles, repetitions, [&]() {
+			return (double)MeanShift::cluster(angles, 0.1f, 0.1f, 10, 0.1f).size();
+		}));
+	}
+
+	std::vector<Point> buffer;
+	if (selected("curveDetector")) {
+		results.push_back(measure("curveDetector", polygons.size(), repetitions, [&]() {
+			cv::RNG rng(seed);
+			double sum = 0;
+			std::vector<Circle> circles;
+			for (int i = 0; i < polygons.size(); i++) {
+				buffer.assign(polygons.contour(i), polygons.contour(i) + polygons.contourSize(i));
+				CurveDetector::detect(buffer.data(), buffer.size(), polygons.isContourClosed(i), params.num_iter, params.min_points, params.max_error_ratio_to_radius, params.cluster_epsilon, params.min_angle, params.min_radius, params.max_radius, circles, rng);
+				sum += circles.size();
+			}
+			return sum;
+		}));
+	}
+
+	if (selected("lineDetector")) {
+		std::vector<float> principal_orientations = OrientationEstimator::estimatePeaks(pgons);
+		results.push_back(measure("lineDetector", polygons.size(), repetitions, [&]() {
+			cv::RNG rng(seed);
+			double sum = 0;
+			std::vector<Line> lines;
+			for (int i = 0; i < polygons.size(); i++) {
+				buffer.assign(polygons.contour(i), polygons.contour(i) + polygons.contourSize(i));
+				LineDetector::detect(buffer.data(), buffer.size(), polygons.isContourClosed(i), params.line_num_iter, params.line_min_points, params.line_max_error, params.line_cluster_epsilon, params.line_min_length, principal_orientations, lines, rng);
+				sum += lines.size();
+			}
+			return sum;
+		}));
+	}
+
+	// a drawing of several tiles with and without a frame around it, traced whole and by tiles; the frame crosses all
+	// the tile borders, so the tiled trace must not cost more than the whole one there, and the checksums must agree
+	for (int framed = 0; framed <= 1; framed++) {
+		std::string suffix = framed ? "/frame" : "/open";
+		if (!selected("findContours" + suffix) && !selected("findContoursTiled" + suffix)) continue;
+
+		cv::Mat drawing = cv::Mat::zeros(6144, 8192, CV_8UC1);
+		cv::RNG rng(seed);
+		for (int i = 0; i < 2000; i++) {
+			cv::Point center(rng.uniform(200, drawing.cols - 200), rng.uniform(200, drawing.rows - 200));
+			cv::circle(drawing, center, rng.uniform(10, 150), cv::Scalar(255), 3);
+		}
+		if (framed) cv::rectangle(drawing, cv::Rect(50, 50, drawing.cols - 100, drawing.rows - 100), cv::Scalar(255), 10);
+
+		PolygonSet traced;
+		if (selected("findContours" + suffix)) {
+			results.push_back(measure("findContours" + suffix, 1, repetitions, [&]() {
+				cv::Mat trace_buffer;
+				findContours(ImageView(drawing), trace_buffer, traced, 100);
+				return (double)traced.points.size();
+			}));
+		}
+		if (selected("findContoursTiled" + suffix)) {
+			results.push_back(measure("findContoursTiled" + suffix, 1, repetitions, [&]() {
+				findContoursTiled(ImageView(drawing), traced, 100);
+				return (double)traced.points.size();
+			}));
+		}
+	}
+
+	// the whole pipeline on one thread, from reading the file to the primitives, without rendering
+	pipeline.detect_lines = true;
+	Workspace workspace;
+	for (auto& input : inputs) {
+		size_t slash = input.find_last_of("/\\");
+		std::string name = "pipeline/" + (slash == std::string::npos ? input : input.substr(slash + 1));
+		if (!selected(name)) continue;
+
+		results.push_back(measure(name, 1, repetitions, [&]() {
+			Job job(input, "");
+			if (!pipeline.process(job, &workspace)) return -1.0;
+			return (double)(job.circles.size() + job.lines.size());
+		}));
+	}
+
+	out << "{\"seed\":" << seed << ",\"repetitions\":" << repetitions << ",\"stats\":" << (DetectorStats::enabled() ? "true" : "false")
+		<< ",\"peak_resident_kb\":" << Tracer::peakResidentKB() << ",\"contours\":\"" << ResultWriter::escape(inputs[0]) << "\",\"benchmarks\":[";
+	for (int i = 0; i < results.size(); i++) {
+		const Result& r = results[i];
+		out << (i > 0 ? "," : "") << "\n{\"name\":\"" << ResultWriter::escape(r.name) << "\",\"iterations\":" << r.iterations
+			<< ",\"min_ms\":" << r.min() << ",\"median_ms\":" << r.median() << ",\"mean_ms\":" << r.mean() << ",\"result\":" << r.result;
+		if (Tracer::tracksAllocations()) out << ",\"allocations\":" << r.allocations.allocations << ",\"bytes\":" << r.allocations.bytes;
+		out << "}";
+	}
+	out << "\n]}" << std::endl;
+
+	return 0;
+}
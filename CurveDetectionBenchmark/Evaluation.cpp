@@ -0,0 +1,217 @@
+#include "Evaluation.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+
+namespace {
+
+const int NUM_COVERAGE_SAMPLES = 64;
+
+/**
+ * Read a number, or the first count numbers of an array, from the field of a JSON record.
+ */
+bool readField(const std::string& record, const char* name, float* values, int count) {
+	std::string key = std::string("\"") + name + "\":";
+	size_t pos = record.find(key);
+	if (pos == std::string::npos) return false;
+
+	const char* ptr = record.c_str() + pos + key.size();
+	if (*ptr == '[') ptr++;
+	for (int i = 0; i < count; i++) {
+		char* end;
+		values[i] = std::strtof(ptr, &end);
+		if (end == ptr) return false;
+		ptr = *end == ',' ? end + 1 : end;
+	}
+	return true;
+}
+
+/**
+ * Return whether the angle lies on the arc that spans range from start, both in radians.
+ */
+bool onArc(float angle, float start, float range) {
+	float offset = std::fmod(angle - start, (float)CV_PI * 2);
+	if (offset < 0) offset += CV_PI * 2;
+	return offset <= range;
+}
+
+}
+
+bool GroundTruth::load(const std::string& path) {
+	std::ifstream file(path);
+	if (!file) return false;
+
+	circles.clear();
+	lines.clear();
+	std::string record;
+	while (std::getline(file, record)) {
+		float values[4];
+		if (record.find("\"type\":\"circle\"") != std::string::npos) {
+			Circle circle;
+			if (!readField(record, "center", values, 2)) return false;
+			circle.center = cv::Point2f(values[0], values[1]);
+			if (!readField(record, "radius", &circle.radius, 1)) return false;
+			if (!readField(record, "start_angle", &circle.start_angle, 1)) return false;
+			if (!readField(record, "end_angle", &circle.end_angle, 1)) return false;
+			circle.angle_range = circle.end_angle - circle.start_angle;
+			circles.push_back(circle);
+		}
+		else if (record.find("\"type\":\"line\"") != std::string::npos) {
+			if (!readField(record, "p1", values, 2) || !readField(record, "p2", values + 2, 2)) return false;
+			cv::Point2f p1(values[0], values[1]);
+			cv::Point2f p2(values[2], values[3]);
+			Line line(p1, p2 - p1);
+			std::vector<float> positions;
+			positions.push_back(0);
+			positions.push_back(cv::norm(p2 - p1));
+			line.setEndPositions(positions);
+			lines.push_back(line);
+		}
+	}
+
+	return true;
+}
+
+/**
+ * Return the path of the ground truth of the image, which is named after it with the extension .ndjson.
+ */
+std::string GroundTruth::pathOf(const std::string& image) {
+	size_t dot = image.find_last_of('.');
+	size_t slash = image.find_last_of("/\\");
+	if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) return image + ".ndjson";
+
+	return image.substr(0, dot) + ".ndjson";
+}
+
+void Score::add(const Score& other) {
+	num_truth += other.num_truth;
+	num_recalled += other.num_recalled;
+	num_detected += other.num_detected;
+	num_matched += other.num_matched;
+	position_error += other.position_error;
+	shape_error += other.shape_error;
+}
+
+std::string Score::toJson() const {
+	std::ostringstream out;
+	out << "{\"truth\":" << num_truth << ",\"recalled\":" << num_recalled << ",\"detected\":" << num_detected << ",\"matched\":" << num_matched
+		<< ",\"precision\":" << precision() << ",\"recall\":" << recall() << ",\"position_error\":" << meanPositionError() << ",\"shape_error\":" << meanShapeError() << "}";
+	return out.str();
+}
+
+Score Evaluator::scoreCircles(const std::vector<Circle>& truth, const std::vector<Circle>& detected, const Tolerances& tolerances) {
+	Score score;
+	score.num_truth = truth.size();
+	score.num_detected = detected.size();
+
+	// match each detection to the closest true circle it lies on
+	std::vector<std::vector<int>> matches(truth.size());
+	for (int i = 0; i < detected.size(); i++) {
+		const Circle& d = detected[i];
+		int best = -1;
+		float best_center_error = 0;
+		float best_radius_error = 0;
+		for (int j = 0; j < truth.size(); j++) {
+			const Circle& t = truth[j];
+			float tolerance = tolerances.distance + tolerances.radius_ratio * t.radius;
+			float center_error = cv::norm(d.center - t.center);
+			float radius_error = std::abs(d.radius - t.radius);
+			if (center_error > tolerance || radius_error > tolerance) continue;
+			if (!onArc(d.start_angle + d.angle_range * 0.5f, t.start_angle, t.angle_range + tolerance / t.radius)) continue;
+
+			if (best == -1 || center_error + radius_error < best_center_error + best_radius_error) {
+				best = j;
+				best_center_error = center_error;
+				best_radius_error = radius_error;
+			}
+		}
+		if (best == -1) continue;
+
+		matches[best].push_back(i);
+		score.num_matched++;
+		score.position_error += best_center_error;
+		score.shape_error += best_radius_error;
+	}
+
+	// a true circle is recalled if the arcs of its detections cover enough of it
+	for (int j = 0; j < truth.size(); j++) {
+		const Circle& t = truth[j];
+		float slack = (tolerances.distance + tolerances.radius_ratio * t.radius) / t.radius;
+		int num_covered = 0;
+		for (int k = 0; k < NUM_COVERAGE_SAMPLES; k++) {
+			float angle = t.start_angle + t.angle_range * (k + 0.5f) / NUM_COVERAGE_SAMPLES;
+			for (int i : matches[j]) {
+				if (onArc(angle, detected[i].start_angle - slack, detected[i].angle_range + slack * 2)) {
+					num_covered++;
+					break;
+				}
+			}
+		}
+		if (num_covered >= tolerances.min_coverage * NUM_COVERAGE_SAMPLES) score.num_recalled++;
+	}
+
+	return score;
+}
+
+Score Evaluator::scoreLines(const std::vector<Line>& truth, const std::vector<Line>& detected, const Tolerances& tolerances) {
+	Score score;
+	score.num_truth = truth.size();
+	score.num_detected = detected.size();
+
+	// match each detection to the closest true line it lies on
+	std::vector<std::vector<int>> matches(truth.size());
+	for (int i = 0; i < detected.size(); i++) {
+		const Line& d = detected[i];
+		cv::Point2f p1 = d.point + d.dir * d.start_pos;
+		cv::Point2f p2 = d.point + d.dir * d.end_pos;
+		int best = -1;
+		float best_distance_error = 0;
+		float best_angle_error = 0;
+		for (int j = 0; j < truth.size(); j++) {
+			const Line& t = truth[j];
+			cv::Point2f q1 = t.point + t.dir * t.start_pos;
+			cv::Point2f normal(t.dir.y, -t.dir.x);
+			float distance1 = std::abs((p1 - q1).dot(normal));
+			float distance2 = std::abs((p2 - q1).dot(normal));
+			if (distance1 > tolerances.distance || distance2 > tolerances.distance) continue;
+			float angle_error = std::acos(std::min(1.0f, std::abs(d.dir.dot(t.dir))));
+			if (angle_error > tolerances.angle) continue;
+			float middle = ((p1 + p2) * 0.5f - q1).dot(t.dir);
+			if (middle < -tolerances.distance || middle > t.length + tolerances.distance) continue;
+
+			float distance_error = (distance1 + distance2) * 0.5f;
+			if (best == -1 || distance_error < best_distance_error) {
+				best = j;
+				best_distance_error = distance_error;
+				best_angle_error = angle_error;
+			}
+		}
+		if (best == -1) continue;
+
+		matches[best].push_back(i);
+		score.num_matched++;
+		score.position_error += best_distance_error;
+		score.shape_error += best_angle_error / CV_PI * 180;
+	}
+
+	// a true line is recalled if the projections of its detections cover enough of it
+	for (int j = 0; j < truth.size(); j++) {
+		const Line& t = truth[j];
+		cv::Point2f q1 = t.point + t.dir * t.start_pos;
+		int num_covered = 0;
+		for (int k = 0; k < NUM_COVERAGE_SAMPLES; k++) {
+			float position = t.length * (k + 0.5f) / NUM_COVERAGE_SAMPLES;
+			for (int i : matches[j]) {
+				float a = (detected[i].point + detected[i].dir * detected[i].start_pos - q1).dot(t.dir);
+				float b = (detected[i].point + detected[i].dir * detected[i].end_pos - q1).dot(t.dir);
+				if (position >= std::min(a, b) - tolerances.distance && position <= std::max(a, b) + tolerances.distance) {
+					num_covered++;
+					break;
+				}
+			}
+		}
+		if (num_covered >= tolerances.min_coverage * NUM_COVERAGE_SAMPLES) score.num_recalled++;
+	}
+
+	return score;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "../CurveDetectionNoGUI/CurveDetector.h"
+#include "../CurveDetectionNoGUI/LineDetector.h"
+
+/**
+ * The circles and lines that are known to be in an image, read from the NDJSON records of ResultWriter, such as the
+ * ones that CurveDetectionGenerator writes next to each image.
+ */
+class GroundTruth {
+public:
+	std::vector<Circle> circles;
+	std::vector<Line> lines;
+
+public:
+	bool load(const std::string& path);
+	static std::string pathOf(const std::string& image);
+};
+
+/**
+ * How far a detection may be from a primitive of the ground truth to count as found. Distances are in pixels and
+ * should allow for half the stroke width, since the detectors fit the borders of the strokes, and the radius may
+ * also be off by radius_ratio of it. A primitive is recalled once its detections cover min_coverage of it.
+ */
+class Tolerances {
+public:
+	float distance;
+	float radius_ratio;
+	float angle;
+	float min_coverage;
+
+public:
+	Tolerances() : distance(5), radius_ratio(0.02f), angle(2.0f / 180.0f * CV_PI), min_coverage(0.5f) {}
+};
+
+/**
+ * Counts of the matches between detections and the ground truth, with the geometric errors summed over the matched
+ * detections. For circles, the position error is the distance between the centers and the shape error is the
+ * difference of the radii. For lines, they are the mean distance of the end points from the true line and the
+ * angle between the lines in degrees.
+ */
+class Score {
+public:
+	int num_truth;
+	int num_recalled;
+	int num_detected;
+	int num_matched;
+	double position_error;
+	double shape_error;
+
+public:
+	Score() : num_truth(0), num_recalled(0), num_detected(0), num_matched(0), position_error(0), shape_error(0) {}
+
+	void add(const Score& other);
+	double precision() const { return num_detected > 0 ? (double)num_matched / num_detected : 1.0; }
+	double recall() const { return num_truth > 0 ? (double)num_recalled / num_truth : 1.0; }
+	double meanPositionError() const { return num_matched > 0 ? position_error / num_matched : 0.0; }
+	double meanShapeError() const { return num_matched > 0 ? shape_error / num_matched : 0.0; }
+	std::string toJson() const;
+};
+
+/**
+ * Matches detections to the ground truth. A detection is matched if it lies on some primitive of the ground truth
+ * within the tolerances, so that both borders of a stroke and every piece of a dashed or broken primitive count as
+ * correct, and a primitive is recalled if its matched detections together cover enough of it.
+ */
+class Evaluator {
+protected:
+	Evaluator() {}
+
+public:
+	static Score scoreCircles(const std::vector<Circle>& truth, const std::vector<Circle>& detected, const Tolerances& tolerances);
+	static Score scoreLines(const std::vector<Line>& truth, const std::vector<Line>& detected, const Tolerances& tolerances);
+};
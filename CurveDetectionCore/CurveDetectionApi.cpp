@@ -0,0 +1,260 @@
+#include "CurveDetectionApi.h"
+#include <algorithm>
+#include <cstring>
+#include "../CurveDetectionNoGUI/Util.h"
+#include "../CurveDetectionNoGUI/CurveDetector.h"
+#include "../CurveDetectionNoGUI/LineDetector.h"
+#include "../CurveDetectionNoGUI/OrientationEstimator.h"
+#include "../CurveDetectionNoGUI/CenterlineExtractor.h"
+
+/**
+ * Scratch memory that is kept between calls, so that the calls stop allocating once it has grown.
+ */
+struct cd_workspace {
+	RunLengthImage binary_image;
+	cv::Mat buffer;
+	PolygonSet polygons;
+	PolygonSet resampled;
+	std::vector<Point> points;
+	bool closed;
+	std::vector<Circle> circles;
+	std::vector<Line> lines;
+	DetectorStats circle_stats;
+	DetectorStats line_stats;
+	std::vector<float> principal_angles;
+	std::vector<std::vector<cv::Point2f>> rings;
+	cv::RNG rng;
+
+	cd_workspace() : closed(true), rng(0) {}
+};
+
+namespace {
+
+// the most orientations that cd_estimate_orientations() looks for
+const int MAX_ORIENTATIONS = 64;
+
+void loadPoints(cd_workspace* workspace, const cd_point* points, int num_points, int closed) {
+	workspace->points.resize(num_points);
+	for (int i = 0; i < num_points; i++) {
+		workspace->points[i] = Point(points[i].x, points[i].y, points[i].nx, points[i].ny);
+	}
+	workspace->closed = closed != 0;
+}
+
+void copyStats(const DetectorStats& stats, cd_detector_stats* out) {
+	out->rounds = stats.rounds;
+	out->hypotheses = stats.hypotheses;
+	out->sampling_retries = stats.sampling_retries;
+	out->collinear = stats.collinear;
+	out->radius_range = stats.radius_range;
+	out->angle_range = stats.angle_range;
+	out->normal = stats.normal;
+	out->length = stats.length;
+	out->points_walked = stats.points_walked;
+	out->accepted = stats.accepted;
+}
+
+}
+
+int cd_api_version(void) {
+	return CD_API_VERSION;
+}
+
+int cd_stats_enabled(void) {
+	return DetectorStats::enabled() ? 1 : 0;
+}
+
+cd_workspace* cd_workspace_create(void) {
+	try {
+		return new cd_workspace();
+	}
+	catch (...) {
+		return NULL;
+	}
+}
+
+void cd_workspace_destroy(cd_workspace* workspace) {
+	delete workspace;
+}
+
+cd_status cd_set_seed(cd_workspace* workspace, uint64_t seed) {
+	if (workspace == NULL) return CD_INVALID_ARGUMENT;
+
+	workspace->rng = cv::RNG(seed);
+	return CD_OK;
+}
+
+void cd_circle_params_default(cd_circle_params* params) {
+	params->num_iter = 200000;
+	params->min_points = 200;
+	params->max_error_ratio_to_radius = 0.02f;
+	params->cluster_epsilon = 30;
+	params->min_angle = (float)(CV_PI / 2);
+	params->min_radius = 80;
+	params->max_radius = 400;
+}
+
+void cd_line_params_default(cd_line_params* params) {
+	params->num_iter = 10000;
+	params->min_points = 30;
+	params->max_error = 5;
+	params->cluster_epsilon = 20;
+	params->min_length = 30;
+}
+
+cd_status cd_extract_contours(cd_workspace* workspace, const uint8_t* pixels, int width, int height, size_t stride, int threshold, int min_points, int centerline, int* num_polygons, int* num_rings, int* num_points) {
+	if (workspace == NULL || pixels == NULL || width <= 0 || height <= 0 || stride < (size_t)width) return CD_INVALID_ARGUMENT;
+
+	try {
+		ImageView image(pixels, width, height, stride);
+		if (centerline) {
+			CenterlineExtractor::extract(image, workspace->buffer, workspace->polygons, min_points, threshold);
+		}
+		else {
+			workspace->binary_image.create(image, threshold);
+			findContours(workspace->binary_image, workspace->polygons, min_points);
+		}
+	}
+	catch (...) {
+		workspace->polygons.clear();
+		return CD_INTERNAL_ERROR;
+	}
+
+	if (num_polygons != NULL) *num_polygons = workspace->polygons.size();
+	if (num_rings != NULL) *num_rings = workspace->polygons.numRings();
+	if (num_points != NULL) *num_points = workspace->polygons.points.size();
+	return CD_OK;
+}
+
+cd_status cd_resample_contours(cd_workspace* workspace, float spacing, int* num_polygons, int* num_rings, int* num_points, float* density) {
+	if (workspace == NULL || !(spacing >= 1)) return CD_INVALID_ARGUMENT;
+
+	try {
+		resampleContours(workspace->polygons, workspace->resampled, spacing);
+	}
+	catch (...) {
+		return CD_INTERNAL_ERROR;
+	}
+	if (density != NULL) *density = resampledDensity(spacing);
+	workspace->polygons.swap(workspace->resampled);
+
+	if (num_polygons != NULL) *num_polygons = workspace->polygons.size();
+	if (num_rings != NULL) *num_rings = workspace->polygons.numRings();
+	if (num_points != NULL) *num_points = workspace->polygons.points.size();
+	return CD_OK;
+}
+
+cd_status cd_copy_polygons(const cd_workspace* workspace, cd_point* points, size_t points_capacity, int32_t* ring_offsets, size_t rings_capacity, int32_t* polygon_offsets, size_t polygons_capacity, uint8_t* ring_closed) {
+	if (workspace == NULL || points == NULL || ring_offsets == NULL || polygon_offsets == NULL) return CD_INVALID_ARGUMENT;
+
+	const PolygonSet& polygons = workspace->polygons;
+	if (points_capacity < polygons.points.size() || rings_capacity < polygons.ring_offsets.size() || polygons_capacity < polygons.polygon_offsets.size()) {
+		return CD_BUFFER_TOO_SMALL;
+	}
+
+	for (int i = 0; i < polygons.points.size(); i++) {
+		const Point& p = polygons.points[i];
+		points[i].x = p.pos.x;
+		points[i].y = p.pos.y;
+		points[i].nx = p.normal.x;
+		points[i].ny = p.normal.y;
+	}
+	std::copy(polygons.ring_offsets.begin(), polygons.ring_offsets.end(), ring_offsets);
+	std::copy(polygons.polygon_offsets.begin(), polygons.polygon_offsets.end(), polygon_offsets);
+	if (ring_closed != NULL) std::copy(polygons.ring_closed.begin(), polygons.ring_closed.end(), ring_closed);
+
+	return CD_OK;
+}
+
+cd_status cd_detect_circles(cd_workspace* workspace, const cd_point* points, int num_points, int closed, const cd_circle_params* params, cd_circle* circles, size_t capacity, int* num_circles) {
+	if (workspace == NULL || points == NULL || num_points < 0 || params == NULL || (circles == NULL && capacity > 0)) return CD_INVALID_ARGUMENT;
+	if (params->num_iter < 1 || params->min_points < 1 || !(params->cluster_epsilon >= 1)) return CD_INVALID_ARGUMENT;
+
+	try {
+		loadPoints(workspace, points, num_points, closed);
+		workspace->circle_stats.clear();
+		CurveDetector::detect(workspace->points.data(), num_points, workspace->closed, params->num_iter, params->min_points, params->max_error_ratio_to_radius, params->cluster_epsilon, params->min_angle, params->min_radius, params->max_radius, workspace->circles, workspace->rng, &workspace->circle_stats);
+	}
+	catch (...) {
+		return CD_INTERNAL_ERROR;
+	}
+
+	const std::vector<Circle>& found = workspace->circles;
+	for (int i = 0; i < found.size() && i < capacity; i++) {
+		circles[i].cx = found[i].center.x;
+		circles[i].cy = found[i].center.y;
+		circles[i].radius = found[i].radius;
+		circles[i].start_angle = found[i].start_angle;
+		circles[i].end_angle = found[i].end_angle;
+		circles[i].num_points = found[i].points.size();
+	}
+	if (num_circles != NULL) *num_circles = found.size();
+
+	return found.size() <= capacity ? CD_OK : CD_BUFFER_TOO_SMALL;
+}
+
+cd_status cd_detect_lines(cd_workspace* workspace, const cd_point* points, int num_points, int closed, const cd_line_params* params, const float* principal_angles, int num_angles, cd_line* lines, size_t capacity, int* num_lines) {
+	if (workspace == NULL || num_points < 0 || params == NULL || (principal_angles == NULL && num_angles > 0) || (lines == NULL && capacity > 0)) return CD_INVALID_ARGUMENT;
+	if (params->num_iter < 1 || params->min_points < 1 || !(params->cluster_epsilon >= 1)) return CD_INVALID_ARGUMENT;
+
+	try {
+		if (points != NULL) loadPoints(workspace, points, num_points, closed);
+		workspace->principal_angles.assign(principal_angles, principal_angles + num_angles);
+		workspace->line_stats.clear();
+		LineDetector::detect(workspace->points.data(), workspace->points.size(), workspace->closed, params->num_iter, params->min_points, params->max_error, params->cluster_epsilon, params->min_length, workspace->principal_angles, workspace->lines, workspace->rng, &workspace->line_stats);
+	}
+	catch (...) {
+		return CD_INTERNAL_ERROR;
+	}
+
+	const std::vector<Line>& found = workspace->lines;
+	for (int i = 0; i < found.size() && i < capacity; i++) {
+		cv::Point2f p1 = found[i].point + found[i].dir * found[i].start_pos;
+		cv::Point2f p2 = found[i].point + found[i].dir * found[i].end_pos;
+		lines[i].x1 = p1.x;
+		lines[i].y1 = p1.y;
+		lines[i].x2 = p2.x;
+		lines[i].y2 = p2.y;
+		lines[i].dx = found[i].dir.x;
+		lines[i].dy = found[i].dir.y;
+		lines[i].num_points = found[i].points.size();
+	}
+	if (num_lines != NULL) *num_lines = found.size();
+
+	return found.size() <= capacity ? CD_OK : CD_BUFFER_TOO_SMALL;
+}
+
+cd_status cd_get_stats(const cd_workspace* workspace, cd_detector_stats* circle_stats, cd_detector_stats* line_stats) {
+	if (workspace == NULL) return CD_INVALID_ARGUMENT;
+
+	if (circle_stats != NULL) copyStats(workspace->circle_stats, circle_stats);
+	if (line_stats != NULL) copyStats(workspace->line_stats, line_stats);
+	return CD_OK;
+}
+
+cd_status cd_estimate_orientations(cd_workspace* workspace, const cd_point* points, const int32_t* ring_offsets, int num_rings, float* angles, size_t capacity, int* num_angles) {
+	if (workspace == NULL || points == NULL || ring_offsets == NULL || num_rings < 0 || (angles == NULL && capacity > 0)) return CD_INVALID_ARGUMENT;
+	if (ring_offsets[0] < 0) return CD_INVALID_ARGUMENT;
+	for (int r = 0; r < num_rings; r++) {
+		if (ring_offsets[r + 1] < ring_offsets[r]) return CD_INVALID_ARGUMENT;
+	}
+
+	std::vector<float> peaks;
+	try {
+		workspace->rings.resize(num_rings);
+		for (int r = 0; r < num_rings; r++) {
+			workspace->rings[r].clear();
+			for (int i = ring_offsets[r]; i < ring_offsets[r + 1]; i++) workspace->rings[r].push_back(cv::Point2f(points[i].x, points[i].y));
+		}
+		// without room for any, look for as many as there may be, to tell how many are needed
+		peaks = OrientationEstimator::estimatePeaks(workspace->rings, capacity == 0 ? MAX_ORIENTATIONS : (int)std::min<size_t>(capacity, MAX_ORIENTATIONS));
+	}
+	catch (...) {
+		return CD_INTERNAL_ERROR;
+	}
+
+	std::copy(peaks.begin(), peaks.begin() + std::min(peaks.size(), capacity), angles);
+	if (num_angles != NULL) *num_angles = peaks.size();
+
+	return peaks.size() <= capacity ? CD_OK : CD_BUFFER_TOO_SMALL;
+}
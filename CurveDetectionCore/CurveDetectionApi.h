@@ -0,0 +1,178 @@
+#ifndef CURVE_DETECTION_API_H
+#define CURVE_DETECTION_API_H
+
+/**
+ * C interface of the curve detection core, for embedding the detectors in other processes.
+ *
+ * All the memory that the caller sees is owned by the caller: results are copied into the buffers it passes, along
+ * with their capacities. A function whose results do not fit returns CD_BUFFER_TOO_SMALL with the required counts
+ * set, so the caller can grow its buffers and call again. The scratch memory of the detectors lives in opaque
+ * workspaces, which stop allocating once they have grown to the largest input. A workspace must not be used by two
+ * threads at a time, but any number of workspaces can be used in parallel.
+ *
+ * Define CURVE_DETECTION_STATIC when linking the static library.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(CURVE_DETECTION_STATIC)
+#define CD_API
+#elif defined(_WIN32)
+#ifdef CURVE_DETECTION_EXPORTS
+#define CD_API __declspec(dllexport)
+#else
+#define CD_API __declspec(dllimport)
+#endif
+#else
+#define CD_API __attribute__((visibility("default")))
+#endif
+
+#define CD_API_VERSION 1
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+	CD_OK = 0,
+	CD_INVALID_ARGUMENT = -1,
+	CD_BUFFER_TOO_SMALL = -2,
+	CD_INTERNAL_ERROR = -3
+} cd_status;
+
+typedef struct cd_workspace cd_workspace;
+
+/** Contour point with its normal. */
+typedef struct {
+	float x, y;
+	float nx, ny;
+} cd_point;
+
+/** Circular arc from start_angle to end_angle in radians. */
+typedef struct {
+	float cx, cy;
+	float radius;
+	float start_angle, end_angle;
+	int32_t num_points;
+} cd_circle;
+
+/** Line segment from (x1, y1) to (x2, y2) along the unit direction (dx, dy). */
+typedef struct {
+	float x1, y1;
+	float x2, y2;
+	float dx, dy;
+	int32_t num_points;
+} cd_line;
+
+/**
+ * Arguments of the circle detector. min_angle is in radians. num_iter and min_points must be at least 1, and so
+ * must cluster_epsilon, the largest index distance between the sampled points.
+ */
+typedef struct {
+	int32_t num_iter;
+	int32_t min_points;
+	float max_error_ratio_to_radius;
+	float cluster_epsilon;
+	float min_angle;
+	float min_radius;
+	float max_radius;
+} cd_circle_params;
+
+/** Arguments of the line detector, with the same bounds on num_iter, min_points and cluster_epsilon. */
+typedef struct {
+	int32_t num_iter;
+	int32_t min_points;
+	float max_error;
+	float cluster_epsilon;
+	float min_length;
+} cd_line_params;
+
+/**
+ * Counters of where the RANSAC iterations of a detector call went, in the order of DetectorStats. They stay zero
+ * unless the library was built with CURVE_DETECTION_STATS defined.
+ */
+typedef struct {
+	int64_t rounds;
+	int64_t hypotheses;
+	int64_t sampling_retries;
+	int64_t collinear;
+	int64_t radius_range;
+	int64_t angle_range;
+	int64_t normal;
+	int64_t length;
+	int64_t points_walked;
+	int64_t accepted;
+} cd_detector_stats;
+
+CD_API int cd_api_version(void);
+CD_API int cd_stats_enabled(void);
+
+CD_API cd_workspace* cd_workspace_create(void);
+CD_API void cd_workspace_destroy(cd_workspace* workspace);
+
+/**
+ * Reseed the generator from which the detectors of the workspace sample their points. A new workspace starts from
+ * seed 0, so the same calls on it always give the same results.
+ */
+CD_API cd_status cd_set_seed(cd_workspace* workspace, uint64_t seed);
+
+CD_API void cd_circle_params_default(cd_circle_params* params);
+CD_API void cd_line_params_default(cd_line_params* params);
+
+/**
+ * Trace the borders of the pixels brighter than threshold in a grayscale image, keeping the polygons whose outer
+ * contour has at least min_points points. With centerline set, the strokes are thinned and their centerlines are
+ * traced instead, as open or closed polylines without holes. The polygons stay in the workspace, and their counts
+ * are returned for cd_copy_polygons().
+ */
+CD_API cd_status cd_extract_contours(cd_workspace* workspace, const uint8_t* pixels, int width, int height, size_t stride, int threshold, int min_points, int centerline, int* num_polygons, int* num_rings, int* num_points);
+
+/**
+ * Replace the polygons of the last extraction by the same rings with their smooth parts thinned out to points about
+ * spacing pixels apart, while the corners keep all their points, which makes the detection faster on large
+ * drawings. The point counts and index distances given to the detectors should then be multiplied by the returned
+ * density, the points left per original point along the smooth runs, so that they stand for the same arc length.
+ * The new counts are returned as in cd_extract_contours().
+ */
+CD_API cd_status cd_resample_contours(cd_workspace* workspace, float spacing, int* num_polygons, int* num_rings, int* num_points, float* density);
+
+/**
+ * Copy the polygons of the last extraction or resampling. The points of ring r are points[ring_offsets[r], ring_offsets[r + 1]),
+ * and the rings of polygon p are [polygon_offsets[p], polygon_offsets[p + 1]), its outer contour first and then
+ * its holes. ring_closed may be NULL. The buffers hold num_points points, num_rings + 1 and num_polygons + 1
+ * offsets, and num_rings flags.
+ */
+CD_API cd_status cd_copy_polygons(const cd_workspace* workspace, cd_point* points, size_t points_capacity, int32_t* ring_offsets, size_t rings_capacity, int32_t* polygon_offsets, size_t polygons_capacity, uint8_t* ring_closed);
+
+/**
+ * Detect circular arcs in a contour. The points are copied into the workspace, and the ones that the arcs take
+ * are excluded from a following cd_detect_lines() call on the same contour.
+ */
+CD_API cd_status cd_detect_circles(cd_workspace* workspace, const cd_point* points, int num_points, int closed, const cd_circle_params* params, cd_circle* circles, size_t capacity, int* num_circles);
+
+/**
+ * Detect line segments in a contour, snapping them to the principal angles, if any. With points NULL, the lines
+ * are detected in the points of the contour of the last call that no primitive took.
+ */
+CD_API cd_status cd_detect_lines(cd_workspace* workspace, const cd_point* points, int num_points, int closed, const cd_line_params* params, const float* principal_angles, int num_angles, cd_line* lines, size_t capacity, int* num_lines);
+
+/**
+ * Return the counters of the last cd_detect_circles() and cd_detect_lines() calls on the workspace.
+ * Either pointer may be NULL.
+ */
+CD_API cd_status cd_get_stats(const cd_workspace* workspace, cd_detector_stats* circle_stats, cd_detector_stats* line_stats);
+
+/**
+ * Estimate up to capacity principal orientations, at most 64, in radians and in descending order of support, of the
+ * rings given as in cd_copy_polygons(): ring_offsets has num_rings + 1 entries that start at 0 or more and never
+ * decrease, or CD_INVALID_ARGUMENT is returned, and the last one is the number of points. With capacity 0, angles
+ * may be NULL and CD_BUFFER_TOO_SMALL is returned with the number of orientations found, if there are any.
+ */
+CD_API cd_status cd_estimate_orientations(cd_workspace* workspace, const cd_point* points, const int32_t* ring_offsets, int num_rings, float* angles, size_t capacity, int* num_angles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
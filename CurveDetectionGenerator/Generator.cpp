@@ -0,0 +1,215 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include "../CurveDetectionNoGUI/ResultWriter.h"
+
+namespace {
+
+/**
+ * What to draw. Radii, lengths, the stroke width and the dash pattern are in pixels, and noise is the standard
+ * deviation of the Gaussian noise added to the pixel values.
+ */
+class Settings {
+public:
+	int width;
+	int height;
+	int num_circles;
+	int num_arcs;
+	int num_lines;
+	float min_radius;
+	float max_radius;
+	float min_arc_angle;
+	float min_length;
+	float max_length;
+	int stroke;
+	float dash;
+	float gap;
+	float noise;
+
+public:
+	Settings() : width(2000), height(1500), num_circles(3), num_arcs(3), num_lines(10), min_radius(80), max_radius(400), min_arc_angle(CV_PI / 2), min_length(100), max_length(800), stroke(3), dash(0), gap(0), noise(0) {}
+};
+
+/**
+ * Draw the path through the points, leaving out the gaps of the dash pattern, and keep the drawn points as the
+ * points of the primitive.
+ */
+void drawPath(cv::Mat& image, const std::vector<cv::Point2f>& path, const Settings& settings, std::vector<cv::Point2f>& drawn) {
+	std::vector<cv::Point> dash;
+	for (int i = 0; i < path.size(); i++) {
+		// the points are one pixel apart, so the index is the distance along the path
+		bool on = settings.dash <= 0 || settings.gap <= 0 || std::fmod((float)i, settings.dash + settings.gap) < settings.dash;
+		if (on) {
+			dash.push_back(cv::Point(cvRound(path[i].x), cvRound(path[i].y)));
+			drawn.push_back(path[i]);
+		}
+		if ((!on || i + 1 == path.size()) && dash.size() > 0) {
+			cv::polylines(image, dash, false, cv::Scalar(255), settings.stroke);
+			dash.clear();
+		}
+	}
+}
+
+/**
+ * Draw an arc from start_angle to end_angle, or a circle if it spans 2 PI, in the angle convention of the
+ * detectors, which measure the angles in image coordinates.
+ */
+Circle drawArc(cv::Mat& image, const cv::Point2f& center, float radius, float start_angle, float end_angle, const Settings& settings) {
+	Circle circle(center, radius);
+	circle.start_angle = start_angle;
+	circle.end_angle = end_angle;
+	circle.angle_range = end_angle - start_angle;
+
+	int num_points = std::max(2, (int)std::ceil(radius * circle.angle_range));
+	std::vector<cv::Point2f> path(num_points + 1);
+	for (int i = 0; i <= num_points; i++) {
+		float angle = start_angle + circle.angle_range * i / num_points;
+		path[i] = cv::Point2f(center.x + radius * std::cos(angle), center.y + radius * std::sin(angle));
+	}
+	drawPath(image, path, settings, circle.points);
+
+	return circle;
+}
+
+Line drawLine(cv::Mat& image, const cv::Point2f& p1, const cv::Point2f& p2, const Settings& settings) {
+	Line line(p1, p2 - p1);
+	std::vector<float> positions;
+	positions.push_back(0);
+	positions.push_back(cv::norm(p2 - p1));
+	line.setEndPositions(positions);
+
+	int num_points = std::max(1, (int)std::ceil(line.length));
+	std::vector<cv::Point2f> path(num_points + 1);
+	for (int i = 0; i <= num_points; i++) path[i] = p1 + (p2 - p1) * ((float)i / num_points);
+	drawPath(image, path, settings, line.points);
+
+	return line;
+}
+
+/**
+ * Draw a drawing with the circles, arcs and lines at random positions inside the image, as white strokes on black
+ * like the bundled drawings, and return the primitives as drawn.
+ */
+cv::Mat generate(const Settings& settings, cv::RNG& rng, std::vector<Circle>& circles, std::vector<Line>& lines) {
+	cv::Mat image(settings.height, settings.width, CV_8U, cv::Scalar(0));
+	float margin = settings.stroke + 1;
+
+	// the largest radius that still fits in the image
+	float max_radius = std::min(settings.max_radius, std::min(settings.width, settings.height) * 0.5f - margin);
+	float min_radius = std::min(settings.min_radius, max_radius);
+	for (int i = 0; i < settings.num_circles + settings.num_arcs; i++) {
+		float radius = rng.uniform(min_radius, max_radius);
+		cv::Point2f center(rng.uniform(radius + margin, settings.width - radius - margin), rng.uniform(radius + margin, settings.height - radius - margin));
+		float start_angle = rng.uniform(0.0f, (float)CV_PI * 2);
+		float angle_range = i < settings.num_circles ? CV_PI * 2 : rng.uniform(settings.min_arc_angle, (float)CV_PI * 1.8f);
+		circles.push_back(drawArc(image, center, radius, start_angle, start_angle + angle_range, settings));
+	}
+
+	float max_length = std::min(settings.max_length, std::sqrt((float)settings.width * settings.width + settings.height * settings.height) * 0.5f);
+	float min_length = std::min(settings.min_length, max_length);
+	for (int i = 0; i < settings.num_lines; i++) {
+		// retry until the other end falls inside the image
+		for (int retry = 0; retry < 100; retry++) {
+			cv::Point2f p1(rng.uniform(margin, settings.width - margin), rng.uniform(margin, settings.height - margin));
+			float length = rng.uniform(min_length, max_length);
+			float angle = rng.uniform(0.0f, (float)CV_PI * 2);
+			cv::Point2f p2 = p1 + cv::Point2f(std::cos(angle), std::sin(angle)) * length;
+			if (p2.x < margin || p2.x >= settings.width - margin || p2.y < margin || p2.y >= settings.height - margin) continue;
+
+			lines.push_back(drawLine(image, p1, p2, settings));
+			break;
+		}
+	}
+
+	if (settings.noise > 0) {
+		cv::Mat noise(image.size(), CV_16S);
+		rng.fill(noise, cv::RNG::NORMAL, 0, settings.noise);
+		cv::Mat noisy;
+		image.convertTo(noisy, CV_16S);
+		noisy += noise;
+		noisy.convertTo(image, CV_8U);
+	}
+
+	return image;
+}
+
+}
+
+/**
+ * Generate synthetic drawings with known circles, arcs and lines, for measuring how each stage scales with the
+ * size of the drawings and how accurately the primitives are detected. Each image is written along with its ground
+ * truth, in the NDJSON records of ResultWriter with polygon -1, so that it can be compared with --results.
+ */
+int main(int argc, char *argv[]) {
+	Settings settings;
+	std::string output_dir;
+	std::string prefix = "synthetic";
+	int count = 1;
+	unsigned int seed = 1;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--count" && i + 1 < argc) count = std::atoi(argv[++i]);
+		else if (arg == "--seed" && i + 1 < argc) seed = std::strtoul(argv[++i], NULL, 10);
+		else if (arg == "--prefix" && i + 1 < argc) prefix = argv[++i];
+		else if (arg == "--size" && i + 1 < argc) sscanf(argv[++i], "%dx%d", &settings.width, &settings.height);
+		else if (arg == "--circles" && i + 1 < argc) settings.num_circles = std::atoi(argv[++i]);
+		else if (arg == "--arcs" && i + 1 < argc) settings.num_arcs = std::atoi(argv[++i]);
+		else if (arg == "--lines" && i + 1 < argc) settings.num_lines = std::atoi(argv[++i]);
+		else if (arg == "--radius" && i + 1 < argc) sscanf(argv[++i], "%f,%f", &settings.min_radius, &settings.max_radius);
+		else if (arg == "--min-arc-angle" && i + 1 < argc) settings.min_arc_angle = std::atof(argv[++i]) / 180.0f * CV_PI;
+		else if (arg == "--length" && i + 1 < argc) sscanf(argv[++i], "%f,%f", &settings.min_length, &settings.max_length);
+		else if (arg == "--stroke" && i + 1 < argc) settings.stroke = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--dash" && i + 1 < argc) sscanf(argv[++i], "%f,%f", &settings.dash, &settings.gap);
+		else if (arg == "--noise" && i + 1 < argc) settings.noise = std::atof(argv[++i]);
+		else if (output_dir.empty()) output_dir = arg;
+		else {
+			output_dir.clear();
+			break;
+		}
+	}
+
+	if (output_dir.empty() || count < 1 || settings.width < 16 || settings.height < 16) {
+		std::cout << "Usage: " << argv[0] << " [options] <output directory>" << std::endl;
+		std::cout << "Options: [--count <n>] [--seed <n>] [--prefix <name>] [--size <width>x<height>] [--circles <n>] [--arcs <n>] [--lines <n>]" << std::endl;
+		std::cout << "         [--radius <min>,<max>] [--min-arc-angle <degrees>] [--length <min>,<max>] [--stroke <width>] [--dash <on>,<off>] [--noise <sigma>]" << std::endl;
+		return -1;
+	}
+
+	for (int i = 0; i < count; i++) {
+		// every image has its own seed, so that one of them can be regenerated alone
+		cv::RNG rng((uint64)seed * 1000003 + i);
+		std::vector<Circle> circles;
+		std::vector<Line> lines;
+		cv::Mat image = generate(settings, rng, circles, lines);
+
+		char name[256];
+		sprintf(name, "%s-%04d", prefix.c_str(), i);
+		std::string image_path = output_dir + "/" + name + ".png";
+		std::string truth_path = output_dir + "/" + name + ".ndjson";
+		if (!cv::imwrite(image_path, image)) {
+			std::cerr << "Cannot write " << image_path << std::endl;
+			return 1;
+		}
+
+		ResultWriter writer;
+		if (!writer.open(truth_path, ResultWriter::NDJSON)) {
+			std::cerr << "Cannot write " << truth_path << std::endl;
+			return 1;
+		}
+		int id = writer.beginImage(image_path, image.cols, image.rows);
+		writer.write(id, -1, circles, lines);
+		writer.endImage(id, circles.size(), lines.size());
+		writer.close();
+
+		std::cerr << image_path << ": " << circles.size() << " circles, " << lines.size() << " lines" << std::endl;
+	}
+
+	return 0;
+}
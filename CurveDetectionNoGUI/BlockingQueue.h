@@ -0,0 +1,55 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ * Bounded queue between two pipeline stages.
+ * push() blocks while the queue is full, so a fast stage cannot run ahead of a slow one by more than capacity items,
+ * and pop() blocks until an item arrives or the queue is closed.
+ */
+template<typename T>
+class BlockingQueue {
+private:
+	std::deque<T> items;
+	size_t capacity;
+	bool closed;
+	std::mutex mutex;
+	std::condition_variable not_empty;
+	std::condition_variable not_full;
+
+public:
+	BlockingQueue(size_t capacity) : capacity(capacity), closed(false) {}
+
+	void push(T item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [&]() { return items.size() < capacity || closed; });
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+	}
+
+	/**
+	 * Take the oldest item, and return false once the queue is closed and drained.
+	 */
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [&]() { return !items.empty() || closed; });
+		if (items.empty()) return false;
+
+		item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	/**
+	 * Tell the consumers that no more items will come.
+	 */
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+};
@@ -0,0 +1,209 @@
+#include "CenterlineExtractor.h"
+
+// 4-neighbours first, so that walks step through the corners of staircases instead of cutting them
+static const int DX[8] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+static const int DY[8] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+// the 8-neighbours in clockwise order starting from the top
+static const int RING_DX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+static const int RING_DY[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+/**
+ * Thin the strokes of the image brighter than threshold to 1 pixel wide skeletons and trace them into polylines.
+ * Each path between two end points or junctions becomes an open polyline, and each loop without junctions becomes
+ * a closed one. Polylines with fewer than min_points points are dropped. buffer is reused across calls.
+ */
+void CenterlineExtractor::extract(const ImageView& image, cv::Mat& buffer, PolygonSet& polylines, int min_points, int threshold) {
+	polylines.clear();
+
+	// threshold into a buffer with a 1 pixel zero frame so that neighbours never need bounds checks
+	buffer.create(image.height + 2, image.width + 2, CV_8UC1);
+	buffer.row(0).setTo(0);
+	buffer.row(buffer.rows - 1).setTo(0);
+	buffer.col(0).setTo(0);
+	buffer.col(buffer.cols - 1).setTo(0);
+	cv::Mat src(image.height, image.width, CV_8UC1, const_cast<uchar*>(image.data), image.stride);
+	cv::Mat interior = buffer(cv::Rect(1, 1, image.width, image.height));
+	cv::threshold(src, interior, threshold, 1, cv::THRESH_BINARY);
+
+	thin(buffer);
+	trace(buffer, min_points, polylines);
+}
+
+/**
+ * Zhang-Suen thinning of a 0/1 image whose border pixels are 0.
+ */
+void CenterlineExtractor::thin(cv::Mat& binary) {
+	std::vector<uchar*> removed;
+	while (true) {
+		bool changed = false;
+		for (int pass = 0; pass < 2; pass++) {
+			removed.clear();
+			for (int y = 1; y < binary.rows - 1; y++) {
+				const uchar* up = binary.ptr<uchar>(y - 1);
+				uchar* row = binary.ptr<uchar>(y);
+				const uchar* down = binary.ptr<uchar>(y + 1);
+				for (int x = 1; x < binary.cols - 1; x++) {
+					if (row[x] == 0) continue;
+
+					// p2, ..., p9 clockwise from the top
+					uchar p[8] = { up[x], up[x + 1], row[x + 1], down[x + 1], down[x], down[x - 1], row[x - 1], up[x - 1] };
+					int num_neighbors = 0;
+					int num_transitions = 0;
+					for (int k = 0; k < 8; k++) {
+						num_neighbors += p[k];
+						if (p[k] == 0 && p[(k + 1) % 8] == 1) num_transitions++;
+					}
+					if (num_neighbors < 2 || num_neighbors > 6 || num_transitions != 1) continue;
+
+					if (pass == 0 && (p[0] * p[2] * p[4] != 0 || p[2] * p[4] * p[6] != 0)) continue;
+					if (pass == 1 && (p[0] * p[2] * p[6] != 0 || p[0] * p[4] * p[6] != 0)) continue;
+
+					removed.push_back(&row[x]);
+				}
+			}
+
+			for (auto pixel : removed) *pixel = 0;
+			if (removed.size() > 0) changed = true;
+		}
+
+		if (!changed) break;
+	}
+
+	// Zhang-Suen leaves the inner corner of every staircase, which makes the stroke 4-connected there and
+	// the corner pixels look like end points. Remove each corner whose neighbours stay 8-connected without it.
+	for (int y = 1; y < binary.rows - 1; y++) {
+		for (int x = 1; x < binary.cols - 1; x++) {
+			if (binary.at<uchar>(y, x) == 0) continue;
+
+			bool n = binary.at<uchar>(y - 1, x) != 0;
+			bool e = binary.at<uchar>(y, x + 1) != 0;
+			bool s = binary.at<uchar>(y + 1, x) != 0;
+			bool w = binary.at<uchar>(y, x - 1) != 0;
+			if ((n && e) || (e && s) || (s && w) || (w && n)) {
+				if (connectivity(binary, x, y) == 1) binary.at<uchar>(y, x) = 0;
+			}
+		}
+	}
+}
+
+/**
+ * Trace a 0/1 skeleton with a zero frame into polylines, which are offset by the frame.
+ */
+void CenterlineExtractor::trace(cv::Mat& skeleton, int min_points, PolygonSet& polylines) {
+	// the skeleton pixels are 1, and become 2 once a walk has visited them
+	std::vector<cv::Point> path;
+	for (int y = 1; y < skeleton.rows - 1; y++) {
+		for (int x = 1; x < skeleton.cols - 1; x++) {
+			if (skeleton.at<uchar>(y, x) == 0 || !isNode(skeleton, x, y)) continue;
+
+			// follow every branch leaving this end point or junction
+			for (int k = 0; k < 8; k++) {
+				cv::Point first(x + DX[k], y + DY[k]);
+				if (skeleton.at<uchar>(first) != 1 || isNode(skeleton, first.x, first.y)) continue;
+
+				walk(skeleton, cv::Point(x, y), first, path);
+				addPolyline(path, false, min_points, polylines);
+			}
+		}
+	}
+
+	// whatever is left are loops without junctions
+	for (int y = 1; y < skeleton.rows - 1; y++) {
+		for (int x = 1; x < skeleton.cols - 1; x++) {
+			if (skeleton.at<uchar>(y, x) != 1 || isNode(skeleton, x, y)) continue;
+
+			skeleton.at<uchar>(y, x) = 2;
+			cv::Point start(x, y);
+			cv::Point first(-1, -1);
+			for (int k = 0; k < 8 && first.x == -1; k++) {
+				if (skeleton.at<uchar>(y + DY[k], x + DX[k]) == 1 && !isNode(skeleton, x + DX[k], y + DY[k])) first = cv::Point(x + DX[k], y + DY[k]);
+			}
+			if (first.x == -1) continue;
+
+			walk(skeleton, start, first, path);
+			bool closed = std::abs(path.back().x - x) <= 1 && std::abs(path.back().y - y) <= 1;
+			addPolyline(path, closed && path.size() >= 3, min_points, polylines);
+		}
+	}
+}
+
+/**
+ * Return true for end points and junctions of the skeleton, i.e., the pixels whose neighbours do not form
+ * exactly two separate groups.
+ */
+bool CenterlineExtractor::isNode(const cv::Mat& skeleton, int x, int y) {
+	return connectivity(skeleton, x, y) != 2;
+}
+
+/**
+ * Return the number of 8-connected groups that the neighbours of the pixel form once the pixel is removed
+ * (Hilditch's 8-connectivity number).
+ */
+int CenterlineExtractor::connectivity(const cv::Mat& skeleton, int x, int y) {
+	bool set[8];
+	for (int k = 0; k < 8; k++) set[k] = skeleton.at<uchar>(y + RING_DY[k], x + RING_DX[k]) != 0;
+
+	// a group ends after each empty 4-neighbour that is followed by a set corner or a set 4-neighbour
+	int num_groups = 0;
+	for (int k = 0; k < 8; k += 2) {
+		if (!set[k] && (set[k + 1] || set[(k + 2) % 8])) num_groups++;
+	}
+	return num_groups;
+}
+
+/**
+ * Walk along the skeleton from start through first until reaching an end point, a junction, or a pixel with no
+ * unvisited neighbour, marking the walked pixels as visited. The path includes start and the last pixel.
+ */
+void CenterlineExtractor::walk(cv::Mat& skeleton, const cv::Point& start, const cv::Point& first, std::vector<cv::Point>& path) {
+	path.clear();
+	path.push_back(start);
+	path.push_back(first);
+	skeleton.at<uchar>(first) = 2;
+
+	cv::Point prev = start;
+	cv::Point cur = first;
+	while (true) {
+		// stop at an adjacent end point or junction, except for start right after leaving it
+		cv::Point next(-1, -1);
+		bool reached_node = false;
+		for (int k = 0; k < 8; k++) {
+			cv::Point q(cur.x + DX[k], cur.y + DY[k]);
+			if (q == prev || skeleton.at<uchar>(q) == 0 || !isNode(skeleton, q.x, q.y)) continue;
+			if (q == start && path.size() < 4) continue;
+			next = q;
+			reached_node = true;
+			break;
+		}
+
+		for (int k = 0; k < 8 && next.x == -1; k++) {
+			cv::Point q(cur.x + DX[k], cur.y + DY[k]);
+			if (skeleton.at<uchar>(q) == 1 && !isNode(skeleton, q.x, q.y)) next = q;
+		}
+		if (next.x == -1) break;
+
+		path.push_back(next);
+		if (reached_node) break;
+
+		// absorb the pixels that thicken the stroke at a staircase, which are adjacent to both cur and next
+		skeleton.at<uchar>(next) = 2;
+		for (int k = 0; k < 8; k++) {
+			cv::Point q(cur.x + DX[k], cur.y + DY[k]);
+			if (skeleton.at<uchar>(q) != 1 || isNode(skeleton, q.x, q.y)) continue;
+			if (std::abs(q.x - next.x) <= 1 && std::abs(q.y - next.y) <= 1) skeleton.at<uchar>(q) = 2;
+		}
+
+		prev = cur;
+		cur = next;
+	}
+}
+
+void CenterlineExtractor::addPolyline(const std::vector<cv::Point>& path, bool closed, int min_points, PolygonSet& polylines) {
+	if (path.size() < std::max(min_points, 2)) return;
+
+	// undo the offset of the zero frame
+	Point* points = polylines.addRing(path.size(), closed);
+	for (int i = 0; i < path.size(); i++) points[i] = Point(path[i].x - 1, path[i].y - 1);
+	polylines.endPolygon();
+}
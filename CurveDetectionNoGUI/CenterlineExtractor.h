@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include "Util.h"
+
+/**
+ * Front end for drawings made of thin strokes, which traces each stroke once along its centerline
+ * instead of along both of its sides like findContours.
+ */
+class CenterlineExtractor {
+protected:
+	CenterlineExtractor() {}
+
+public:
+	static void extract(const ImageView& image, cv::Mat& buffer, PolygonSet& polylines, int min_points = 3, int threshold = 40);
+	static void thin(cv::Mat& binary);
+	static void trace(cv::Mat& skeleton, int min_points, PolygonSet& polylines);
+
+private:
+	static bool isNode(const cv::Mat& skeleton, int x, int y);
+	static int connectivity(const cv::Mat& skeleton, int x, int y);
+	static void walk(cv::Mat& skeleton, const cv::Point& start, const cv::Point& first, std::vector<cv::Point>& path);
+	static void addPolyline(const std::vector<cv::Point>& path, bool closed, int min_points, PolygonSet& polylines);
+};
+
@@ -0,0 +1,240 @@
+#include "ContourCache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <functional>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// hashed into every key, and to be bumped whenever the entry format or the contour extraction changes, so that
+// the entries written by older builds are no longer found
+const uint32_t CACHE_VERSION = 1;
+
+struct Header {
+	char magic[4];
+	int32_t width;
+	int32_t height;
+	uint32_t num_points;
+	uint32_t num_rings;
+	uint32_t num_polygons;
+};
+
+/**
+ * Return true if the offsets start at 0, never decrease, and end at total, as those of a PolygonSet do.
+ */
+bool validOffsets(const std::vector<int>& offsets, uint32_t total) {
+	if (offsets.empty() || offsets[0] != 0 || (int64_t)offsets.back() != (int64_t)total) return false;
+	for (size_t i = 1; i < offsets.size(); i++) {
+		if (offsets[i] < offsets[i - 1]) return false;
+	}
+	return true;
+}
+
+/**
+ * Read-only mapping of a whole file, which is unmapped when it goes out of scope.
+ */
+class MappedFile {
+public:
+	const uchar* data;
+	size_t size;
+
+private:
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int fd;
+#endif
+
+public:
+	MappedFile(const std::string& path) : data(NULL), size(0) {
+#ifdef _WIN32
+		mapping = NULL;
+		file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (file == INVALID_HANDLE_VALUE) return;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) return;
+		mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (mapping == NULL) return;
+		data = (const uchar*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		if (data != NULL) size = file_size.QuadPart;
+#else
+		fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return;
+		struct stat st;
+		if (fstat(fd, &st) != 0 || st.st_size == 0) return;
+		void* addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) return;
+		data = (const uchar*)addr;
+		size = st.st_size;
+#endif
+	}
+
+	~MappedFile() {
+#ifdef _WIN32
+		if (data != NULL) UnmapViewOfFile(data);
+		if (mapping != NULL) CloseHandle(mapping);
+		if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+		if (data != NULL) munmap((void*)data, size);
+		if (fd >= 0) close(fd);
+#endif
+	}
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+}
+
+/**
+ * Return the key of an image given its encoded bytes and a description of the settings that affect the contours,
+ * such as the threshold, so that changing any of them misses the cache, as does a new CACHE_VERSION.
+ */
+std::string ContourCache::key(const std::vector<uchar>& data, const std::string& settings) const {
+	uint64_t h = hash(&CACHE_VERSION, sizeof(CACHE_VERSION), 14695981039346656037ULL);
+	h = hash(data.data(), data.size(), h);
+	h = hash(settings.data(), settings.size(), h);
+
+	char buf[17];
+	sprintf(buf, "%08x%08x", (unsigned)(h >> 32), (unsigned)h);
+	return buf;
+}
+
+/**
+ * Map the entry of the key and copy its contours. Return false if there is no entry or it is damaged.
+ */
+bool ContourCache::load(const std::string& key, PolygonSet& polygons, cv::Size& size) const {
+	MappedFile file(path(key));
+	if (file.size < sizeof(Header)) return false;
+
+	Header header;
+	memcpy(&header, file.data, sizeof(Header));
+	if (memcmp(header.magic, "CDC1", 4) != 0) return false;
+	size_t points_bytes = (size_t)header.num_points * 4 * sizeof(float);
+	size_t rings_bytes = ((size_t)header.num_rings + 1) * sizeof(int32_t);
+	size_t polygons_bytes = ((size_t)header.num_polygons + 1) * sizeof(int32_t);
+	if (file.size != sizeof(Header) + points_bytes + rings_bytes + polygons_bytes + header.num_rings) return false;
+
+	const uchar* ptr = file.data + sizeof(Header);
+	const float* points = (const float*)ptr;
+	ptr += points_bytes;
+	polygons.ring_offsets.resize(header.num_rings + 1);
+	memcpy(polygons.ring_offsets.data(), ptr, rings_bytes);
+	ptr += rings_bytes;
+	polygons.polygon_offsets.resize(header.num_polygons + 1);
+	memcpy(polygons.polygon_offsets.data(), ptr, polygons_bytes);
+	ptr += polygons_bytes;
+	polygons.ring_closed.assign(ptr, ptr + header.num_rings);
+
+	// the offsets index the points and rings, so an entry whose offsets run backwards or out of them is damaged
+	if (!validOffsets(polygons.ring_offsets, header.num_points) || !validOffsets(polygons.polygon_offsets, header.num_rings)) {
+		polygons.clear();
+		return false;
+	}
+
+	polygons.points.resize(header.num_points);
+	for (uint32_t i = 0; i < header.num_points; i++) {
+		polygons.points[i] = Point(points[i * 4], points[i * 4 + 1], points[i * 4 + 2], points[i * 4 + 3]);
+	}
+	size = cv::Size(header.width, header.height);
+
+	return true;
+}
+
+/**
+ * Write the entry of the key. Return false if the cache directory cannot be written to.
+ */
+bool ContourCache::store(const std::string& key, const PolygonSet& polygons, const cv::Size& size) const {
+	Header header;
+	memcpy(header.magic, "CDC1", 4);
+	header.width = size.width;
+	header.height = size.height;
+	header.num_points = polygons.points.size();
+	header.num_rings = polygons.numRings();
+	header.num_polygons = polygons.size();
+
+	std::vector<float> points(polygons.points.size() * 4);
+	for (int i = 0; i < polygons.points.size(); i++) {
+		points[i * 4] = polygons.points[i].pos.x;
+		points[i * 4 + 1] = polygons.points[i].pos.y;
+		points[i * 4 + 2] = polygons.points[i].normal.x;
+		points[i * 4 + 3] = polygons.points[i].normal.y;
+	}
+
+	// the temporary name is unique per process and thread, so that runs storing the same entry do not write into
+	// one file
+	std::string final_path = path(key);
+#ifdef _WIN32
+	unsigned pid = GetCurrentProcessId();
+#else
+	unsigned pid = getpid();
+#endif
+	char suffix[48];
+	sprintf(suffix, ".%x.%x.tmp", pid, (unsigned)std::hash<std::thread::id>()(std::this_thread::get_id()));
+	std::string temp_path = final_path + suffix;
+	{
+		std::ofstream out(temp_path, std::ios::out | std::ios::binary);
+		if (!out.is_open()) return false;
+		out.write((const char*)&header, sizeof(Header));
+		out.write((const char*)points.data(), points.size() * sizeof(float));
+		out.write((const char*)polygons.ring_offsets.data(), polygons.ring_offsets.size() * sizeof(int32_t));
+		out.write((const char*)polygons.polygon_offsets.data(), polygons.polygon_offsets.size() * sizeof(int32_t));
+		out.write((const char*)polygons.ring_closed.data(), polygons.ring_closed.size());
+		if (!out.good()) {
+			out.close();
+			std::remove(temp_path.c_str());
+			return false;
+		}
+	}
+
+	// another run may have stored the same entry in the meantime, in which case its copy is kept
+	if (std::rename(temp_path.c_str(), final_path.c_str()) != 0) {
+		std::remove(temp_path.c_str());
+	}
+
+	return true;
+}
+
+std::string ContourCache::path(const std::string& key) const {
+	if (directory.empty()) return key + ".contours";
+
+	char last = directory[directory.size() - 1];
+	return directory + (last == '/' || last == '\\' ? "" : "/") + key + ".contours";
+}
+
+/**
+ * FNV-1a over 8-byte words followed by the remaining bytes, which is fast enough to hash large scans
+ * in a fraction of the time that decoding them takes.
+ */
+uint64_t ContourCache::hash(const void* data, size_t size, uint64_t seed) {
+	const uint64_t PRIME = 1099511628211ULL;
+	const uchar* bytes = (const uchar*)data;
+	uint64_t h = seed;
+
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, bytes + i, 8);
+		h = (h ^ word) * PRIME;
+	}
+	for (; i < size; i++) {
+		h = (h ^ bytes[i]) * PRIME;
+	}
+
+	// mix the high bits down, since the word-wise multiply leaves the low bits weak
+	h ^= h >> 29;
+	h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 32;
+	return h;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "Util.h"
+
+/**
+ * On-disk cache of extracted contours, so that repeated runs on the same drawings skip decoding and tracing.
+ * Each entry is a file in the cache directory named after a hash of the encoded image bytes and the extraction
+ * settings, which holds the size of the image and the flat arrays of the PolygonSet:
+ *   char magic[4] "CDC1", int32 width, int32 height, uint32 points, uint32 rings, uint32 polygons,
+ *   float points[points][4] (x, y, nx, ny), int32 ring_offsets[rings + 1], int32 polygon_offsets[polygons + 1],
+ *   uint8 ring_closed[rings]
+ * Entries are memory-mapped when they are loaded, and written to a temporary file that is then renamed, so that
+ * concurrent runs never see a partial entry.
+ */
+class ContourCache {
+private:
+	std::string directory;
+
+public:
+	ContourCache(const std::string& directory) : directory(directory) {}
+
+	std::string key(const std::vector<uchar>& data, const std::string& settings) const;
+	bool load(const std::string& key, PolygonSet& polygons, cv::Size& size) const;
+	bool store(const std::string& key, const PolygonSet& polygons, const cv::Size& size) const;
+
+private:
+	std::string path(const std::string& key) const;
+	static uint64_t hash(const void* data, size_t size, uint64_t seed);
+};
@@ -1,10 +1,13 @@
 #include "CurveDetector.h"
 #include <iostream>
 
-void CurveDetector::detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius, std::vector<Circle>& circles) {
+void CurveDetector::detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius, std::vector<Circle>& circles, cv::RNG& rng, DetectorStats* stats, DetectionControl* control) {
+	detect(polygon.data(), polygon.size(), true, num_iter, min_points, max_error_ratio_to_radius, cluster_epsilon, min_angle, min_radius, max_radius, circles, rng, stats, control);
+}
+
+void CurveDetector::detect(Point* polygon, int N, bool closed, int num_iter, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius, std::vector<Circle>& circles, cv::RNG& rng, DetectorStats* stats, DetectionControl* control) {
 	circles.clear();
 
-	int N = polygon.size();
 	if (N < min_points) return;
 
 	int N2 = N;
@@ -16,62 +19,66 @@ void CurveDetector::detect(std::vector<Point>& polygon, int num_iter, int min_po
 		if (!polygon[i].used) unused_list.push_back(i);
 	}
 
+	// the angles of the supporting points, reused by all the hypotheses
+	std::vector<float> angles;
+
 	while (true) {
+		DETECTOR_STAT(stats, rounds);
+		if (control != NULL) control->addRound();
 		int max_num_points = 0;
 		Circle best_circle;
 		int best_index1;
 
 		for (int iter = 0; iter < num_iter; iter++) {
+			// stop at a cancellation with the primitives accepted so far
+			if (control != NULL && !control->proceed(iter, num_iter)) return;
+
 			// randomly sample index1 as a first point, and then, sample two other points that are close to the first one
 			int index1 = -1;
 			int index2 = -1;
 			int index3 = -1;
 			for (int iter2 = 0; iter2 < num_iter; iter2++) {
-				index1 = unused_list[rand() % unused_list.size()];
-				index2 = (int)(index1 + rand() % (int)(cluster_epsilon * 2 + 1) - cluster_epsilon + N2) % N;
-				if (polygon[index2].used) continue;
-				index3 = (int)(index1 + rand() % (int)(cluster_epsilon * 2 + 1) - cluster_epsilon + N2) % N;
-				if (polygon[index3].used) continue;
+				index1 = unused_list[rng.uniform(0, (int)unused_list.size())];
+				index2 = (int)(index1 + rng.uniform(0, (int)(cluster_epsilon * 2 + 1)) - cluster_epsilon + N2);
+				// open paths do not wrap around
+				if (!closed && (index2 < N2 || index2 >= N2 + N)) index2 = -1;
+				else index2 %= N;
+				if (index2 == -1 || polygon[index2].used) {
+					DETECTOR_STAT(stats, sampling_retries);
+					continue;
+				}
+				index3 = (int)(index1 + rng.uniform(0, (int)(cluster_epsilon * 2 + 1)) - cluster_epsilon + N2);
+				if (!closed && (index3 < N2 || index3 >= N2 + N)) index3 = -1;
+				else index3 %= N;
+				if (index3 == -1 || polygon[index3].used) {
+					DETECTOR_STAT(stats, sampling_retries);
+					continue;
+				}
 				break;
 			}
 
 			if (index1 == -1 || index2 == -1 || index3 == -1) continue;
+			DETECTOR_STAT(stats, hypotheses);
 
 			// if three points are collinear, reject this candidate.
-			if (std::abs(crossProduct(polygon[index2].pos - polygon[index1].pos, polygon[index3].pos - polygon[index1].pos)) < 0.001) continue;
+			if (std::abs(crossProduct(polygon[index2].pos - polygon[index1].pos, polygon[index3].pos - polygon[index1].pos)) < 0.001) {
+				DETECTOR_STAT(stats, collinear);
+				continue;
+			}
 
 			// calculate the circle center from three points
 			Circle circle = circleFromPoints(polygon[index1].pos, polygon[index2].pos, polygon[index3].pos);
-			if (circle.radius < min_radius || circle.radius > max_radius) continue;
-
-			// check whether the points are supporting this circle
-			std::vector<float> angles;
-			angles.push_back(std::atan2(polygon[index1].pos.y - circle.center.y, polygon[index1].pos.x - circle.center.x));
-			int num_points = 0;
-			int prev = 0;
-			for (int i = 0; i < N && i - prev < cluster_epsilon; i++) {
-				int idx = (index1 + i) % N;
-				if (polygon[idx].used) break;
-				if (circle.distance(polygon[idx].pos) < circle.radius * max_error_ratio_to_radius) {
-					num_points++;
-					prev = i;
-					angles.push_back(std::atan2(polygon[idx].pos.y - circle.center.y, polygon[idx].pos.x - circle.center.x));
-				}
-			}
-			prev = 0;
-			for (int i = 1; i < N && i - prev < cluster_epsilon; i++) {
-				int idx = (index1 - i + N) % N;
-				if (polygon[idx].used) break;
-				if (circle.distance(polygon[idx].pos) < circle.radius * max_error_ratio_to_radius) {
-					num_points++;
-					prev = i;
-					angles.push_back(std::atan2(polygon[idx].pos.y - circle.center.y, polygon[idx].pos.x - circle.center.x));
-				}
+			if (circle.radius < min_radius || circle.radius > max_radius) {
+				DETECTOR_STAT(stats, radius_range);
+				continue;
 			}
 
-			// calculate angle range
-			circle.setMinMaxAngles(angles);
-			if (circle.angle_range < min_angle) continue;
+			// check whether the points are supporting this circle, and calculate angle range
+			int num_points = walkSupport(polygon, N, closed, index1, max_error_ratio_to_radius, cluster_epsilon, circle, angles, stats);
+			if (circle.angle_range < min_angle) {
+				DETECTOR_STAT(stats, angle_range);
+				continue;
+			}
 
 			if (num_points > max_num_points) {
 				max_num_points = num_points;
@@ -86,7 +93,7 @@ void CurveDetector::detect(std::vector<Point>& polygon, int num_iter, int min_po
 		// update used flag
 		int prev = 0;
 		std::vector<int> potentially_used;
-		for (int i = 0; i < N && i - prev < cluster_epsilon; i++) {
+		for (int i = 0; i < N && i - prev < cluster_epsilon && (closed || best_index1 + i < N); i++) {
 			int idx = (best_index1 + i) % N;
 			if (polygon[idx].used) break;
 			potentially_used.push_back(idx);
@@ -98,7 +105,7 @@ void CurveDetector::detect(std::vector<Point>& polygon, int num_iter, int min_po
 		}
 		prev = 0;
 		potentially_used.clear();
-		for (int i = 1; i < N && i - prev < cluster_epsilon; i++) {
+		for (int i = 1; i < N && i - prev < cluster_epsilon && (closed || best_index1 - i >= 0); i++) {
 			int idx = (best_index1 - i + N) % N;
 			if (polygon[idx].used) break;
 			potentially_used.push_back(idx);
@@ -115,9 +122,47 @@ void CurveDetector::detect(std::vector<Point>& polygon, int num_iter, int min_po
 		}
 
 		circles.push_back(best_circle);
+		if (control != NULL && control->on_circle) control->on_circle(best_circle);
+		DETECTOR_STAT(stats, accepted);
 	}
 }
 
+/**
+ * Walk from index1 in both directions along the polygon, until a used point or a gap of cluster_epsilon points
+ * without any inlier of the circle, and return the number of inliers. The angle range of the circle is set from the
+ * inliers and the first point, and angles is the buffer for their angles.
+ */
+int CurveDetector::walkSupport(const Point* polygon, int N, bool closed, int index1, float max_error_ratio_to_radius, float cluster_epsilon, Circle& circle, std::vector<float>& angles, DetectorStats* stats) {
+	angles.clear();
+	angles.push_back(std::atan2(polygon[index1].pos.y - circle.center.y, polygon[index1].pos.x - circle.center.x));
+	int num_points = 0;
+	int prev = 0;
+	for (int i = 0; i < N && i - prev < cluster_epsilon && (closed || index1 + i < N); i++) {
+		int idx = (index1 + i) % N;
+		if (polygon[idx].used) break;
+		DETECTOR_STAT(stats, points_walked);
+		if (circle.distance(polygon[idx].pos) < circle.radius * max_error_ratio_to_radius) {
+			num_points++;
+			prev = i;
+			angles.push_back(std::atan2(polygon[idx].pos.y - circle.center.y, polygon[idx].pos.x - circle.center.x));
+		}
+	}
+	prev = 0;
+	for (int i = 1; i < N && i - prev < cluster_epsilon && (closed || index1 - i >= 0); i++) {
+		int idx = (index1 - i + N) % N;
+		if (polygon[idx].used) break;
+		DETECTOR_STAT(stats, points_walked);
+		if (circle.distance(polygon[idx].pos) < circle.radius * max_error_ratio_to_radius) {
+			num_points++;
+			prev = i;
+			angles.push_back(std::atan2(polygon[idx].pos.y - circle.center.y, polygon[idx].pos.x - circle.center.x));
+		}
+	}
+
+	circle.setMinMaxAngles(angles);
+	return num_points;
+}
+
 Circle CurveDetector::circleFromPoints(const cv::Point2f& p1, const cv::Point2f& p2, const cv::Point2f& p3) {
 	float offset = p2.x * p2.x + p2.y * p2.y;
 	float bc = (p1.x * p1.x + p1.y * p1.y - offset) / 2.0;
@@ -2,6 +2,8 @@
 
 #include <vector>
 #include "Util.h"
+#include "DetectorStats.h"
+#include "DetectionControl.h"
 
 class Circle {
 public:
@@ -59,7 +61,9 @@ protected:
 	CurveDetector() {}
 
 public:
-	static void detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius, std::vector<Circle>& circles);
+	static void detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius, std::vector<Circle>& circles, cv::RNG& rng, DetectorStats* stats = NULL, DetectionControl* control = NULL);
+	static void detect(Point* polygon, int N, bool closed, int num_iter, int min_points, float max_error_ratio_to_radius, float cluster_epsilon, float min_angle, float min_radius, float max_radius, std::vector<Circle>& circles, cv::RNG& rng, DetectorStats* stats = NULL, DetectionControl* control = NULL);
+	static int walkSupport(const Point* polygon, int N, bool closed, int index1, float max_error_ratio_to_radius, float cluster_epsilon, Circle& circle, std::vector<float>& angles, DetectorStats* stats = NULL);
 	static Circle circleFromPoints(const cv::Point2f& p1, const cv::Point2f& p2, const cv::Point2f& p3);
 	static float crossProduct(const cv::Point2f& a, const cv::Point2f& b);
 };
@@ -0,0 +1,455 @@
+#include "Daemon.h"
+#include <iostream>
+#include <thread>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <chrono>
+#include <cerrno>
+#include <system_error>
+#ifdef _WIN32
+#define NOMINMAX
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET socket_t;
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+typedef int socket_t;
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#define SD_BOTH SHUT_RDWR
+#endif
+
+namespace {
+
+/**
+ * Buffered reading and writing on a connected socket. The writing side is a streambuf, so that a ResultWriter can
+ * stream its records to the client, which receives them whenever the writer flushes.
+ */
+class Connection : public std::streambuf {
+private:
+	socket_t socket;
+	char input[65536];
+	size_t input_begin;
+	size_t input_end;
+	char output[16384];
+
+public:
+	Connection(socket_t socket) : socket(socket), input_begin(0), input_end(0) {
+		setp(output, output + sizeof(output));
+	}
+
+	~Connection() {
+		closesocket(socket);
+	}
+
+	/**
+	 * Read up to the next line feed, and return false once the client has closed the connection, or once the line
+	 * has grown past max_length, in which case it is left longer than max_length.
+	 */
+	bool readLine(std::string& line, size_t max_length) {
+		line.clear();
+		while (true) {
+			while (input_begin < input_end) {
+				char c = input[input_begin++];
+				if (c == '\n') {
+					if (!line.empty() && line.back() == '\r') line.pop_back();
+					return true;
+				}
+				line += c;
+				if (line.size() > max_length) return false;
+			}
+			if (!fill()) return false;
+		}
+	}
+
+	bool read(size_t size, std::vector<uchar>& data) {
+		data.resize(size);
+		size_t num_read = 0;
+		while (num_read < size) {
+			if (input_begin == input_end && !fill()) return false;
+			size_t n = std::min(size - num_read, input_end - input_begin);
+			memcpy(data.data() + num_read, input + input_begin, n);
+			input_begin += n;
+			num_read += n;
+		}
+		return true;
+	}
+
+protected:
+	int overflow(int c) {
+		if (!send()) return traits_type::eof();
+		if (c != traits_type::eof()) {
+			*pptr() = c;
+			pbump(1);
+		}
+		return traits_type::not_eof(c);
+	}
+
+	int sync() {
+		return send() ? 0 : -1;
+	}
+
+private:
+	bool fill() {
+		int n = recv(socket, input, sizeof(input), 0);
+		if (n <= 0) return false;
+		input_begin = 0;
+		input_end = n;
+		return true;
+	}
+
+	bool send() {
+		for (const char* ptr = pbase(); ptr < pptr();) {
+			int n = ::send(socket, ptr, pptr() - ptr, 0);
+			if (n <= 0) return false;
+			ptr += n;
+		}
+		setp(output, output + sizeof(output));
+		return true;
+	}
+};
+
+enum AcceptError { ACCEPT_RETRY, ACCEPT_BACK_OFF, ACCEPT_CLOSED };
+
+/**
+ * Tell what accept() failing on the listener means: a connection that was reset or a signal before it was
+ * accepted is skipped, running out of descriptors or memory is waited out, and only a listener that is closed or
+ * no longer a socket ends the serving. Anything else is retried after the back-off, rather than taking the daemon
+ * down for all the clients.
+ */
+AcceptError acceptError() {
+#ifdef _WIN32
+	switch (WSAGetLastError()) {
+	case WSAECONNRESET:
+		return ACCEPT_RETRY;
+	case WSAEINTR:
+	case WSAENOTSOCK:
+	case WSAEINVAL:
+	case WSANOTINITIALISED:
+		return ACCEPT_CLOSED;
+	default:
+		return ACCEPT_BACK_OFF;
+	}
+#else
+	switch (errno) {
+	case EINTR:
+	case ECONNABORTED:
+	case EPROTO:
+		return ACCEPT_RETRY;
+	case EBADF:
+	case EINVAL:
+	case ENOTSOCK:
+		return ACCEPT_CLOSED;
+	default:
+		return ACCEPT_BACK_OFF;
+	}
+#endif
+}
+
+const int ACCEPT_BACK_OFF_MS = 100;
+
+/**
+ * Read-only mapping of the first size bytes of a shared memory segment, which is unmapped when it goes out of scope.
+ */
+class SharedMemory {
+public:
+	const uchar* data;
+
+private:
+	size_t size;
+#ifdef _WIN32
+	HANDLE mapping;
+#endif
+
+public:
+	SharedMemory(const std::string& name, size_t size) : data(NULL), size(size) {
+#ifdef _WIN32
+		mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, name.c_str());
+		if (mapping == NULL) return;
+		data = (const uchar*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, size);
+#else
+		int fd = shm_open(name.c_str(), O_RDONLY, 0);
+		if (fd < 0) return;
+		struct stat st;
+		if (fstat(fd, &st) == 0 && (size_t)st.st_size >= size) {
+			void* addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+			if (addr != MAP_FAILED) data = (const uchar*)addr;
+		}
+		close(fd);
+#endif
+	}
+
+	~SharedMemory() {
+#ifdef _WIN32
+		if (data != NULL) UnmapViewOfFile(data);
+		if (mapping != NULL) CloseHandle(mapping);
+#else
+		if (data != NULL) munmap((void*)data, size);
+#endif
+	}
+
+private:
+	SharedMemory(const SharedMemory&);
+	SharedMemory& operator=(const SharedMemory&);
+};
+
+}
+
+Daemon::Daemon(const Pipeline& pipeline, ResultWriter::Format format) : pipeline(pipeline), format(format), requests(pipeline.num_workers * 2) {
+}
+
+/**
+ * Listen on the address, a socket path or a loopback port on Windows, and serve the clients until the listener is
+ * closed. The connections still open are then shut down, and their threads and the workers are joined.
+ * Return -1 if the address cannot be listened on.
+ */
+int Daemon::serve(const std::string& address) {
+#ifdef _WIN32
+	WSADATA wsa_data;
+	if (WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) return -1;
+
+	socket_t listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+	sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(std::atoi(address.c_str()));
+#else
+	// a client that disconnects before its reply is sent must not take the daemon down
+	signal(SIGPIPE, SIG_IGN);
+
+	socket_t listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (address.size() >= sizeof(addr.sun_path)) {
+		std::cerr << "Socket path too long: " << address << std::endl;
+		return -1;
+	}
+	strcpy(addr.sun_path, address.c_str());
+
+	// remove the socket that a previous daemon left behind
+	unlink(address.c_str());
+#endif
+
+	if (listener == INVALID_SOCKET || bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, SOMAXCONN) != 0) {
+		std::cerr << "Cannot listen on " << address << std::endl;
+		return -1;
+	}
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < pipeline.num_workers; i++) {
+		workers.push_back(std::thread(&Daemon::work, this));
+	}
+	std::cerr << "Listening on " << address << " with " << pipeline.num_workers << " workers" << std::endl;
+
+	while (true) {
+		socket_t connection = accept(listener, NULL, NULL);
+		if (connection == INVALID_SOCKET) {
+			AcceptError error = acceptError();
+			if (error == ACCEPT_CLOSED) break;
+			if (error == ACCEPT_BACK_OFF) std::this_thread::sleep_for(std::chrono::milliseconds(ACCEPT_BACK_OFF_MS));
+			continue;
+		}
+
+		// the threads of the clients that have left are joined as new ones arrive
+		joinHandlers(false);
+		std::lock_guard<std::mutex> lock(handlers_mutex);
+		handlers.emplace_back((intptr_t)connection);
+		try {
+			handlers.back().thread = std::thread(&Daemon::handle, this, &handlers.back());
+		}
+		catch (const std::system_error&) {
+			// out of threads, so the client is turned away and the others keep being served
+			handlers.pop_back();
+			closesocket(connection);
+		}
+	}
+
+	std::cerr << "Cannot accept connections on " << address << std::endl;
+	closesocket(listener);
+
+	// the handlers waiting for a request are woken up by shutting down their sockets, and those waiting for a
+	// reply get it from the workers, which are still running
+	{
+		std::lock_guard<std::mutex> lock(handlers_mutex);
+		for (auto& handler : handlers) {
+			if (!handler.finished) shutdown((socket_t)handler.socket, SD_BOTH);
+		}
+	}
+	joinHandlers(true);
+	requests.close();
+	for (auto& worker : workers) worker.join();
+
+	return 0;
+}
+
+/**
+ * Run the requests of all the connections, reusing the same workspace for each of them.
+ */
+void Daemon::work() {
+	Workspace workspace;
+	Request* request;
+	while (requests.pop(request)) {
+		try {
+			bool decoded = request->pipeline.process(request->job, &workspace);
+			request->done.set_value(decoded ? "" : "Cannot read " + request->job.input);
+		}
+		catch (const std::exception& e) {
+			request->done.set_value(e.what());
+		}
+		catch (...) {
+			request->done.set_value("Cannot process " + request->job.input);
+		}
+	}
+}
+
+/**
+ * Serve the requests of one client in order, streaming the records of each image as they are detected.
+ */
+void Daemon::handle(Handler* handler) {
+	Connection connection((socket_t)handler->socket);
+	std::ostream out(&connection);
+	ResultWriter writer;
+	writer.open(out, format);
+
+	// a failure on this thread, such as running out of memory for a request, only ends this connection
+	try {
+		std::string line;
+		while (connection.readLine(line, MAX_LINE_LENGTH)) {
+			if (line.empty()) continue;
+
+			Request request;
+			request.pipeline = pipeline;
+			request.pipeline.writer = &writer;
+			request.pipeline.render = false;
+
+			// the image bytes follow the line even if the rest of the request is invalid
+			size_t num_bytes = 0;
+			std::string error;
+			bool valid = parse(line, request, num_bytes, error);
+			if (num_bytes > MAX_IMAGE_BYTES) {
+				writer.writeError("Image too large: " + std::to_string((unsigned long long)num_bytes) + " bytes");
+				break;
+			}
+			if (num_bytes > 0 && !connection.read(num_bytes, request.job.data)) break;
+			if (!valid) {
+				writer.writeError(error);
+				continue;
+			}
+
+			// wrap the pixels of a shared image without copying them, and keep them mapped until the job is done
+			std::unique_ptr<SharedMemory> shared_image;
+			if (request.shared) {
+				shared_image.reset(new SharedMemory(request.job.input, request.stride * (request.job.size.height - 1) + request.job.size.width));
+				if (shared_image->data == NULL) {
+					writer.writeError("Cannot map " + request.job.input);
+					continue;
+				}
+				request.job.image = cv::Mat(request.job.size, CV_8U, (void*)shared_image->data, request.stride);
+			}
+
+			std::future<std::string> result = request.done.get_future();
+			requests.push(&request);
+			error = result.get();
+			if (!error.empty()) writer.writeError(error);
+		}
+		if (line.size() > MAX_LINE_LENGTH) writer.writeError("Request line too long");
+	}
+	catch (const std::exception& e) {
+		writer.writeError(e.what());
+	}
+	catch (...) {
+		writer.writeError("Cannot serve the request");
+	}
+
+	writer.close();
+
+	// the socket is closed once this returns, after which serve() must not shut it down
+	std::lock_guard<std::mutex> lock(handlers_mutex);
+	handler->finished = true;
+}
+
+/**
+ * Join the threads of the connections that have finished, or of all of them, and forget them.
+ */
+void Daemon::joinHandlers(bool all) {
+	std::list<Handler> done;
+	{
+		std::lock_guard<std::mutex> lock(handlers_mutex);
+		for (auto it = handlers.begin(); it != handlers.end();) {
+			auto next = std::next(it);
+			if (all || it->finished) done.splice(done.end(), handlers, it);
+			it = next;
+		}
+	}
+
+	for (auto& handler : done) {
+		if (handler.thread.joinable()) handler.thread.join();
+	}
+}
+
+/**
+ * Parse a request line into the job and the pipeline settings of the request. For detect-bytes, num_bytes is set
+ * to the size of the image that follows, and for detect-shm, the job gets the segment name and the image size. Return false with a message for an invalid request.
+ */
+bool Daemon::parse(const std::string& line, Request& request, size_t& num_bytes, std::string& error) const {
+	size_t pos = line.find(' ');
+	std::string command = line.substr(0, pos);
+	std::string argument;
+	std::string unknown;
+	while (pos != std::string::npos) {
+		size_t begin = line.find_first_not_of(' ', pos);
+		if (begin == std::string::npos) break;
+		pos = line.find(' ', begin);
+
+		// the first token that is not a parameter starts the path, which may contain spaces
+		std::string token = line.substr(begin, pos - begin);
+		size_t equal = token.find('=');
+		if (equal == std::string::npos) {
+			argument = line.substr(begin);
+			break;
+		}
+
+		std::string name = token.substr(0, equal);
+		float value = std::atof(token.c_str() + equal + 1);
+		if (name == "lines") request.pipeline.detect_lines = value != 0;
+		else if (name == "stats") request.pipeline.stats = value != 0;
+		else if (!request.pipeline.params.set(name, value)) unknown = name;
+	}
+
+	if (command == "detect") {
+		request.job.input = argument;
+		if (argument.empty()) error = "Missing image path";
+	}
+	else if (command == "detect-bytes") {
+		request.job.input = "-";
+		num_bytes = std::strtoul(argument.c_str(), NULL, 10);
+		if (num_bytes == 0) error = "Missing image size";
+	}
+	else if (command == "detect-shm") {
+		std::istringstream fields(argument);
+		fields >> request.job.input >> request.job.size.width >> request.job.size.height;
+		if (!(fields >> request.stride)) request.stride = request.job.size.width;
+		request.shared = true;
+		if (request.job.input.empty() || request.job.size.width <= 0 || request.job.size.height <= 0 || request.stride < request.job.size.width) {
+			error = "Invalid shared image: " + argument;
+		}
+	}
+	else {
+		error = "Unknown command: " + command;
+	}
+	if (error.empty() && !unknown.empty()) error = "Unknown parameter: " + unknown;
+
+	return error.empty();
+}
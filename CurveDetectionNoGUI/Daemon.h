@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <cstdint>
+#include "Pipeline.h"
+#include "BlockingQueue.h"
+
+/**
+ * Long-lived server that keeps OpenCV loaded and the workspaces of its workers warm, so that interactive tools only
+ * pay for the detection itself. It listens on a Unix domain socket, or on a loopback TCP port on Windows, and
+ * serves each connection one request at a time, while the requests of different connections share the worker pool.
+ *
+ * A request is one line of text, with optional name=value detector parameters (see Parameters::set, plus lines=0|1 and stats=0|1)
+ * followed by either the path of an image, the number of bytes of an encoded image that follow the line, or the
+ * name of a shared memory segment that holds a grayscale image, which is traced in place without being copied:
+ *   detect [name=value ...] <path>
+ *   detect-bytes [name=value ...] <size>
+ *   detect-shm [name=value ...] <segment name> <width> <height> [<row stride>]
+ * The client owns the segment, which must stay in place until the reply has ended. It is a POSIX shm_open name
+ * such as /page0, or the name of a file mapping on Windows.
+ * The reply is the stream of ResultWriter records of the image, ending with its end record, or an error record.
+ * A request line longer than MAX_LINE_LENGTH or an image of more than MAX_IMAGE_BYTES gets an error record, after
+ * which the connection is closed, since the rest of the stream can no longer be told apart.
+ */
+class Daemon {
+public:
+	static const size_t MAX_LINE_LENGTH = 64 * 1024;
+	static const size_t MAX_IMAGE_BYTES = 1024 * 1024 * 1024;
+
+private:
+	struct Request {
+		Pipeline pipeline;
+		Job job;
+		bool shared;
+		size_t stride;
+		std::promise<std::string> done;
+
+		Request() : shared(false), stride(0) {}
+	};
+
+	// the thread serving a connection, which is marked finished before it closes its socket
+	struct Handler {
+		intptr_t socket;
+		std::thread thread;
+		bool finished;
+
+		Handler(intptr_t socket) : socket(socket), finished(false) {}
+	};
+
+	const Pipeline& pipeline;
+	ResultWriter::Format format;
+	BlockingQueue<Request*> requests;
+	std::mutex handlers_mutex;
+	std::list<Handler> handlers;
+
+public:
+	Daemon(const Pipeline& pipeline, ResultWriter::Format format);
+
+	int serve(const std::string& address);
+
+private:
+	void work();
+	void handle(Handler* handler);
+	void joinHandlers(bool all);
+	bool parse(const std::string& line, Request& request, size_t& num_bytes, std::string& error) const;
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+class Circle;
+class Line;
+
+/**
+ * Shared between a running detector and another thread that watches it. The detector adds its rounds and
+ * iterations to the counters as it goes, and once cancel() is called, it stops within CHECK_INTERVAL iterations
+ * and returns the primitives that it has accepted so far.
+ *
+ * The detector also passes each primitive to on_circle or on_line, if set, as soon as a round accepts it, so that
+ * the results can be used before the detector returns. The callbacks run on the thread of the detector, and the
+ * primitive is still appended to the results as usual.
+ */
+class DetectionControl {
+public:
+	static const int CHECK_INTERVAL = 1024;
+
+	std::function<void(const Circle&)> on_circle;
+	std::function<void(const Line&)> on_line;
+
+private:
+	std::atomic<bool> cancelled;
+	std::atomic<int64_t> rounds;
+	std::atomic<int64_t> iterations;
+
+public:
+	DetectionControl() : cancelled(false), rounds(0), iterations(0) {}
+
+	void cancel() { cancelled.store(true); }
+	bool isCancelled() const { return cancelled.load(std::memory_order_relaxed); }
+	int64_t numRounds() const { return rounds.load(std::memory_order_relaxed); }
+	int64_t numIterations() const { return iterations.load(std::memory_order_relaxed); }
+
+	void addRound() { rounds.fetch_add(1, std::memory_order_relaxed); }
+
+	/**
+	 * Return whether to go on with the iteration iter of a round of num_iter iterations. The detectors call it at
+	 * every iteration, but it only counts the next batch of iterations and checks the flag every CHECK_INTERVAL of
+	 * them, so that the atomics stay off the hot path.
+	 */
+	bool proceed(int iter, int num_iter) {
+		if (iter % CHECK_INTERVAL != 0) return true;
+
+		iterations.fetch_add(num_iter - iter < CHECK_INTERVAL ? num_iter - iter : CHECK_INTERVAL, std::memory_order_relaxed);
+		return !isCancelled();
+	}
+};
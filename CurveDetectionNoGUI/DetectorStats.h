@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sstream>
+
+/**
+ * Counters of where the RANSAC iterations of a detector go. They are only collected when the detectors are compiled
+ * with CURVE_DETECTION_STATS defined. Otherwise DETECTOR_STAT expands to nothing, and the counters stay zero.
+ */
+#ifdef CURVE_DETECTION_STATS
+#define DETECTOR_STAT(stats, counter) do { if (stats != NULL) stats->counter++; } while (0)
+#else
+#define DETECTOR_STAT(stats, counter) do {} while (0)
+#endif
+
+class DetectorStats {
+public:
+	int64_t rounds;				// searches for the next primitive, including the last one that finds none
+	int64_t hypotheses;			// candidate primitives sampled
+	int64_t sampling_retries;	// samples discarded because a point was used or off the end of an open path
+	int64_t collinear;			// circles rejected because their three points are collinear
+	int64_t radius_range;		// circles rejected because the radius is out of range
+	int64_t angle_range;		// circles rejected because the arc spans less than min_angle
+	int64_t normal;				// lines rejected because they are not perpendicular to the contour normal
+	int64_t length;				// lines rejected because they are shorter than min_length
+	int64_t points_walked;		// points visited to count the support of the candidates
+	int64_t accepted;			// primitives found
+
+public:
+	DetectorStats() { clear(); }
+
+	static bool enabled() {
+#ifdef CURVE_DETECTION_STATS
+		return true;
+#else
+		return false;
+#endif
+	}
+
+	void clear() {
+		rounds = hypotheses = sampling_retries = collinear = radius_range = angle_range = normal = length = points_walked = accepted = 0;
+	}
+
+	void add(const DetectorStats& other) {
+		rounds += other.rounds;
+		hypotheses += other.hypotheses;
+		sampling_retries += other.sampling_retries;
+		collinear += other.collinear;
+		radius_range += other.radius_range;
+		angle_range += other.angle_range;
+		normal += other.normal;
+		length += other.length;
+		points_walked += other.points_walked;
+		accepted += other.accepted;
+	}
+
+	std::string toJson() const {
+		std::ostringstream out;
+		out << "{\"rounds\":" << rounds << ",\"hypotheses\":" << hypotheses << ",\"sampling_retries\":" << sampling_retries
+			<< ",\"collinear\":" << collinear << ",\"radius_range\":" << radius_range << ",\"angle_range\":" << angle_range
+			<< ",\"normal\":" << normal << ",\"length\":" << length << ",\"points_walked\":" << points_walked << ",\"accepted\":" << accepted << "}";
+		return out.str();
+	}
+};
@@ -1,16 +1,19 @@
 #include "LineDetector.h"
 #include "MeanShift.h"
 
-void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error, float cluster_epsilon, float min_length, const std::vector<float>& principal_angles, std::vector<Line>& lines) {
+void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error, float cluster_epsilon, float min_length, const std::vector<float>& principal_angles, std::vector<Line>& lines, cv::RNG& rng, DetectorStats* stats, DetectionControl* control) {
+	detect(polygon.data(), polygon.size(), true, num_iter, min_points, max_error, cluster_epsilon, min_length, principal_angles, lines, rng, stats, control);
+}
+
+void LineDetector::detect(Point* polygon, int N, bool closed, int num_iter, int min_points, float max_error, float cluster_epsilon, float min_length, const std::vector<float>& principal_angles, std::vector<Line>& lines, cv::RNG& rng, DetectorStats* stats, DetectionControl* control) {
 	lines.clear();
 
-	int N = polygon.size();
 	if (N < min_points) return;
 
-	std::vector<cv::Point2f> normals(polygon.size());
+	std::vector<cv::Point2f> normals(N);
 	for (int i = 0; i < N; i++) {
-		int prev = (i - 3 + N) % N;
-		int next = (i + 3) % N;
+		int prev = closed ? (i - 3 + N) % N : std::max(i - 3, 0);
+		int next = closed ? (i + 3) % N : std::min(i + 3, N - 1);
 		cv::Point2f dir = polygon[next].pos - polygon[prev].pos;
 		dir /= cv::norm(dir);
 		polygon[i].normal = cv::Point2f(dir.y, -dir.x);
@@ -26,28 +29,43 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 	}
 
 	while (true) {
+		DETECTOR_STAT(stats, rounds);
+		if (control != NULL) control->addRound();
 		int max_num_points = 0;
 		Line best_line;
 		int best_index1;
 
 		for (int iter = 0; iter < num_iter && unused_list.size() >= 2; iter++) {
+			// stop at a cancellation with the primitives accepted so far
+			if (control != NULL && !control->proceed(iter, num_iter)) return;
+
 			// randomly sample index1 as a first point, and then, sample another point that are close to the first one
 			int index1 = -1;
 			int index2 = -1;
 			for (int iter2 = 0; iter2 < num_iter && unused_list.size() >= 2; iter2++) {
-				index1 = unused_list[rand() % unused_list.size()];
-				index2 = (int)(index1 + rand() % (int)(cluster_epsilon * 2 + 1) - cluster_epsilon + N2) % N;
-				if (index2 == index1 || polygon[index2].used) continue;
+				index1 = unused_list[rng.uniform(0, (int)unused_list.size())];
+				index2 = (int)(index1 + rng.uniform(0, (int)(cluster_epsilon * 2 + 1)) - cluster_epsilon + N2);
+				// open paths do not wrap around
+				if (!closed && (index2 < N2 || index2 >= N2 + N)) index2 = -1;
+				else index2 %= N;
+				if (index2 == -1 || index2 == index1 || polygon[index2].used) {
+					DETECTOR_STAT(stats, sampling_retries);
+					continue;
+				}
 				break;
 			}
 
 			if (index1 == -1 || index2 == -1) continue;
+			DETECTOR_STAT(stats, hypotheses);
 
 			// calculate the direction
 			Line line(polygon[index1].pos, polygon[index2].pos - polygon[index1].pos);
 
 			// cancel this proposal if the normal is too different
-			if (std::abs(line.dir.dot(normals[index1])) > 0.1f) continue;
+			if (std::abs(line.dir.dot(normals[index1])) > 0.1f) {
+				DETECTOR_STAT(stats, normal);
+				continue;
+			}
 
 			// snap the orientation to the closest principal orientation
 			if (principal_angles.size() > 0) {
@@ -64,7 +82,10 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 				}
 
 				if (min_diff <= 0.17f) {
-					if (std::abs(best_angle - angle) <= CV_PI * 0.25) {
+					// the direction is either the principal orientation or its perpendicular, regardless of the sign of dir
+					float diff = angle - best_angle;
+					diff -= CV_PI * std::floor(diff / CV_PI + 0.5);
+					if (std::abs(diff) <= CV_PI * 0.25) {
 						line.dir = cv::Point2f(std::cos(best_angle), std::sin(best_angle));
 					}
 					else {
@@ -78,9 +99,10 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 			positions.push_back(0);
 			int num_points = 0;
 			int prev = 0;
-			for (int i = 0; i < N && i - prev < cluster_epsilon; i++) {
+			for (int i = 0; i < N && i - prev < cluster_epsilon && (closed || index1 + i < N); i++) {
 				int idx = (index1 + i) % N;
 				if (polygon[idx].used) break;
+				DETECTOR_STAT(stats, points_walked);
 				if (line.distance(polygon[idx].pos) < max_error) {
 					num_points++;
 					prev = i;
@@ -88,9 +110,10 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 				}
 			}
 			prev = 0;
-			for (int i = 1; i < N && i - prev < cluster_epsilon; i++) {
+			for (int i = 1; i < N && i - prev < cluster_epsilon && (closed || index1 - i >= 0); i++) {
 				int idx = (index1 - i + N) % N;
 				if (polygon[idx].used) break;
+				DETECTOR_STAT(stats, points_walked);
 				if (line.distance(polygon[idx].pos) < max_error) {
 					num_points++;
 					prev = i;
@@ -100,7 +123,10 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 
 			// calculate angle range
 			line.setEndPositions(positions);
-			if (line.length < min_length) continue;
+			if (line.length < min_length) {
+				DETECTOR_STAT(stats, length);
+				continue;
+			}
 
 			if (num_points > max_num_points) {
 				max_num_points = num_points;
@@ -115,7 +141,7 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 		// update used flag
 		int prev = 0;
 		std::vector<int> potentially_used;
-		for (int i = 0; i < N && i - prev < cluster_epsilon; i++) {
+		for (int i = 0; i < N && i - prev < cluster_epsilon && (closed || best_index1 + i < N); i++) {
 			int idx = (best_index1 + i) % N;
 			if (polygon[idx].used) break;
 			potentially_used.push_back(idx);
@@ -127,7 +153,7 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 		}
 		prev = 0;
 		potentially_used.clear();
-		for (int i = 1; i < N && i - prev < cluster_epsilon; i++) {
+		for (int i = 1; i < N && i - prev < cluster_epsilon && (closed || best_index1 - i >= 0); i++) {
 			int idx = (best_index1 - i + N) % N;
 			if (polygon[idx].used) break;
 			potentially_used.push_back(idx);
@@ -144,5 +170,7 @@ void LineDetector::detect(std::vector<Point>& polygon, int num_iter, int min_poi
 		}
 
 		lines.push_back(best_line);
+		if (control != NULL && control->on_line) control->on_line(best_line);
+		DETECTOR_STAT(stats, accepted);
 	}
 }
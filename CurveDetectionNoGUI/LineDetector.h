@@ -2,6 +2,8 @@
 
 #include <vector>
 #include "Util.h"
+#include "DetectorStats.h"
+#include "DetectionControl.h"
 
 class Line {
 public:
@@ -36,6 +38,7 @@ protected:
 	LineDetector() {}
 
 public:
-	static void detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error, float cluster_epsilon, float min_length, const std::vector<float>& principal_angles, std::vector<Line>& lines);
+	static void detect(std::vector<Point>& polygon, int num_iter, int min_points, float max_error, float cluster_epsilon, float min_length, const std::vector<float>& principal_angles, std::vector<Line>& lines, cv::RNG& rng, DetectorStats* stats = NULL, DetectionControl* control = NULL);
+	static void detect(Point* polygon, int N, bool closed, int num_iter, int min_points, float max_error, float cluster_epsilon, float min_length, const std::vector<float>& principal_angles, std::vector<Line>& lines, cv::RNG& rng, DetectorStats* stats = NULL, DetectionControl* control = NULL);
 };
 
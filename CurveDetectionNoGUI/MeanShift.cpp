@@ -1,39 +1,121 @@
 #include "MeanShift.h"
+#include <opencv2/core/hal/hal.hpp>
 
+/**
+ * Cluster the angles modulo PI/2 and return the modes of the clusters in descending order of their sizes.
+ * Each angle is shifted towards the Gaussian weighted mean of the angles within look_distance until
+ * no shift exceeds a small fraction of the bandwidth or n_iterations is reached, and the converged
+ * positions closer than distance to each other are merged into one mode.
+ */
 std::vector<float> MeanShift::cluster(const std::vector<float>& original_X, float kernel_bandwidth, float distance, int n_iterations, float look_distance) {
-	std::vector<float> X = original_X;
+	const float period = CV_PI * 0.5;
+	int N = original_X.size();
+	if (N == 0) return std::vector<float>();
+
+	// a window wider than the circle would count the same angle twice
+	look_distance = std::min(look_distance, period * 0.5f);
+
+	// sort the angles on the circle once
+	std::vector<float> X(N);
+	for (int i = 0; i < N; i++) {
+		X[i] = regularize_angle(original_X[i]);
+		if (X[i] >= period) X[i] -= period;
+	}
+	std::sort(X.begin(), X.end());
+
+	// unroll the circle by look_distance on both ends so that every window is a contiguous range
+	std::vector<float> unrolled;
+	unrolled.reserve(N * 2);
+	for (int i = 0; i < N; i++) {
+		if (X[i] >= period - look_distance) unrolled.push_back(X[i] - period);
+	}
+	unrolled.insert(unrolled.end(), X.begin(), X.end());
+	for (int i = 0; i < N; i++) {
+		if (X[i] > look_distance) break;
+		unrolled.push_back(X[i] + period);
+	}
+	int M = unrolled.size();
 
-	//std::vector<float> past_X;
+	// the normalization of the kernel cancels out in the weighted mean
+	const float exponent_scale = -0.5f / (kernel_bandwidth * kernel_bandwidth);
+	const float tolerance = kernel_bandwidth * 0.001f;
+
+	std::vector<float> modes = X;
+	std::vector<float> buffer(M);
+	std::vector<float> weights(M);
 	for (int iter = 0; iter < n_iterations; iter++) {
-		for (auto& x : X) {
-			// Step 1. For each datapoint x \in X, find the neighbouring points N(x) of x.
-			std::vector<float> neighbours = neighbourhood_points(X, x, look_distance);
+		float max_shift = 0;
+
+		// the modes stay almost sorted, so the window slides forward except where a mode wraps around
+		int lo = 0;
+		int hi = 0;
+		for (int i = 0; i < N; i++) {
+			float x = modes[i];
+			while (lo > 0 && unrolled[lo - 1] >= x - look_distance) lo--;
+			while (lo < M && unrolled[lo] < x - look_distance) lo++;
+			hi = std::max(hi, lo);
+			while (hi > lo && unrolled[hi - 1] > x + look_distance) hi--;
+			while (hi < M && unrolled[hi] <= x + look_distance) hi++;
+			int count = hi - lo;
+			if (count == 0) continue;
+
+			for (int j = 0; j < count; j++) {
+				float d = unrolled[lo + j] - x;
+				buffer[j] = exponent_scale * d * d;
+			}
+			cv::hal::exp32f(buffer.data(), weights.data(), count);
 
-			// Step 2. For each datapoint x \in X, calculate the mean shift m(x).
 			float numerator = 0;
 			float denominator = 0;
-			for (auto neighbour : neighbours) {
-				// normalize neighbour
-				neighbour = regularize_angle(neighbour);
-				if (neighbour - x > CV_PI * 0.25) neighbour -= CV_PI * 0.5;
-				else if (x - neighbour > CV_PI * 0.25) neighbour += CV_PI * 0.5;
-
-				distance = angular_distance(neighbour, x);
-				float weight = gaussian_kernel(distance, kernel_bandwidth);
-				numerator += (weight * neighbour);
-				denominator += weight;
+			for (int j = 0; j < count; j++) {
+				numerator += weights[j] * (unrolled[lo + j] - x);
+				denominator += weights[j];
 			}
 
-			float new_x = numerator / denominator;
+			float shift = numerator / denominator;
+			max_shift = std::max(max_shift, std::abs(shift));
+
+			x += shift;
+			if (x < 0) x += period;
+			else if (x >= period) x -= period;
+			modes[i] = x;
+		}
+
+		if (max_shift < tolerance) break;
+	}
 
-			// Step 3. For each datapoint x \in X, update x <- m(x).
-			x = new_x;
+	// merge the converged positions that are closer than distance
+	std::sort(modes.begin(), modes.end());
+	std::vector<float> sums;
+	std::vector<int> counts;
+	for (int i = 0; i < N; i++) {
+		if (i == 0 || modes[i] - modes[i - 1] > distance) {
+			sums.push_back(0);
+			counts.push_back(0);
 		}
+		sums.back() += modes[i];
+		counts.back()++;
+	}
+	if (sums.size() > 1 && modes[0] + period - modes.back() <= distance) {
+		// the first cluster continues the last one across PI/2
+		sums.back() += sums[0] + counts[0] * period;
+		counts.back() += counts[0];
+		sums.erase(sums.begin());
+		counts.erase(counts.begin());
+	}
 
-		//past_X.append(np.copy(X))
+	std::vector<std::pair<int, float>> clusters(sums.size());
+	for (int i = 0; i < sums.size(); i++) {
+		float mode = sums[i] / counts[i];
+		if (mode >= period) mode -= period;
+		clusters[i] = std::make_pair(counts[i], mode);
 	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const std::pair<int, float>& a, const std::pair<int, float>& b) { return a.first > b.first; });
 
-	return X;
+	std::vector<float> ret(clusters.size());
+	for (int i = 0; i < clusters.size(); i++) ret[i] = clusters[i].second;
+
+	return ret;
 }
 
 /**
@@ -63,21 +145,6 @@ float MeanShift::regularize_angle(float x) {
 	return x;
 }
 
-std::vector<float> MeanShift::neighbourhood_points(std::vector<float>& X, float x_centroid, float distance) {
-	std::vector<float> eligible_X;
-
-	for (auto& x : X) {
-		float distance_between = angular_distance(x, x_centroid);
-
-		// print('Evaluating: [%s vs %s] yield dist=%.2f' % (x, x_centroid, distance_between))
-		if (distance_between <= distance) {
-			eligible_X.push_back(x);
-		}
-	}
-
-	return eligible_X;
-}
-
 float MeanShift::gaussian_kernel(float distance, float bandwidth) {
 	float val = (1 / (bandwidth * std::sqrt(2 * CV_PI))) * std::exp(-0.5 * std::pow(distance / bandwidth, 2));
 	return val;
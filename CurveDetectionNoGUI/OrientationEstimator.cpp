@@ -3,26 +3,7 @@
 #include <fstream>
 
 float OrientationEstimator::estimate(const std::vector<std::vector<cv::Point2f>>& polygons) {
-	int max_rho = 0;
-	for (auto& polygon : polygons) {
-		for (auto& pt : polygon) {
-			max_rho = std::max(max_rho, (int)std::ceil(pt.x * pt.x + pt.y * pt.y));
-		}
-	}
-
-	cv::Mat_<float> HT(max_rho * 2 + 1, 180, 0.0f);
-	for (auto& polygon : polygons) {
-		for (auto& pt : polygon) {
-			for (int angle = 0; angle < 180; angle++) {
-				float rho = pt.x * std::cos((float)angle / 180.0f * CV_PI) + pt.y * std::sin((float)angle / 180.0f * CV_PI);
-				HT(std::round(rho) + max_rho, angle)++;
-			}
-		}
-	}
-
-	HT = HT.mul(HT);
-	cv::Mat sumHT;
-	cv::reduce(HT, sumHT, 0, cv::REDUCE_SUM);
+	cv::Mat sumHT = votes(polygons);
 
 	/*
 	std::ofstream out("result.txt");
@@ -33,7 +14,7 @@ float OrientationEstimator::estimate(const std::vector<std::vector<cv::Point2f>>
 	*/
 
 	float max_votes = 0;
-	int max_angle;
+	int max_angle = 0;
 	for (int c = 0; c < sumHT.cols; c++) {
 		if (sumHT.at<float>(0, c) > max_votes) {
 			max_votes = sumHT.at<float>(0, c);
@@ -45,16 +26,46 @@ float OrientationEstimator::estimate(const std::vector<std::vector<cv::Point2f>>
 }
 
 float OrientationEstimator::estimate(const std::vector<cv::Point2f>& polygon) {
+	return estimate(std::vector<std::vector<cv::Point2f>>(1, polygon));
+}
+
+/**
+ * Return up to max_peaks principal orientations in descending order of votes.
+ * Peaks are the local maxima of the summed Hough profile that are at least min_ratio of the way
+ * from the baseline to the strongest peak. Since LineDetector snaps to both an orientation and
+ * its perpendicular, peaks closer than min_separation modulo 90 degrees to a stronger one are suppressed.
+ */
+std::vector<float> OrientationEstimator::estimatePeaks(const std::vector<std::vector<cv::Point2f>>& polygons, int max_peaks, float min_separation, float min_ratio) {
+	cv::Mat sumHT = votes(polygons);
+	return findPeaks(sumHT, max_peaks, min_separation, min_ratio);
+}
+
+/**
+ * Vote in the Hough space with 1 degree bins and return the squared votes summed over rho as a 1x180 profile.
+ */
+cv::Mat OrientationEstimator::votes(const std::vector<std::vector<cv::Point2f>>& polygons) {
+	// |rho| never exceeds the distance from the origin
 	int max_rho = 0;
-	for (auto& pt : polygon) {
-		max_rho = std::max(max_rho, (int)std::ceil(pt.x * pt.x + pt.y * pt.y));
+	for (auto& polygon : polygons) {
+		for (auto& pt : polygon) {
+			max_rho = std::max(max_rho, (int)std::ceil(std::sqrt(pt.x * pt.x + pt.y * pt.y)));
+		}
+	}
+
+	float cos_table[180];
+	float sin_table[180];
+	for (int angle = 0; angle < 180; angle++) {
+		cos_table[angle] = std::cos((float)angle / 180.0f * CV_PI);
+		sin_table[angle] = std::sin((float)angle / 180.0f * CV_PI);
 	}
 
 	cv::Mat_<float> HT(max_rho * 2 + 1, 180, 0.0f);
-	for (auto& pt : polygon) {
-		for (int angle = 0; angle < 180; angle++) {
-			float rho = pt.x * std::cos((float)angle / 180.0f * CV_PI) + pt.y * std::sin((float)angle / 180.0f * CV_PI);
-			HT(std::round(rho) + max_rho, angle)++;
+	for (auto& polygon : polygons) {
+		for (auto& pt : polygon) {
+			for (int angle = 0; angle < 180; angle++) {
+				float rho = pt.x * cos_table[angle] + pt.y * sin_table[angle];
+				HT(std::round(rho) + max_rho, angle)++;
+			}
 		}
 	}
 
@@ -62,22 +73,49 @@ float OrientationEstimator::estimate(const std::vector<cv::Point2f>& polygon) {
 	cv::Mat sumHT;
 	cv::reduce(HT, sumHT, 0, cv::REDUCE_SUM);
 
-	/*
-	std::ofstream out("result.txt");
-	for (int c = 0; c < sumHT.cols; c++) {
-		out << sumHT.at<float>(0, c) << std::endl;
+	return sumHT;
+}
+
+std::vector<float> OrientationEstimator::findPeaks(const cv::Mat& sumHT, int max_peaks, float min_separation, float min_ratio) {
+	std::vector<float> peaks;
+
+	double min_votes, max_votes;
+	cv::minMaxLoc(sumHT, &min_votes, &max_votes);
+	if (max_votes <= min_votes) return peaks;
+
+	// collect the local maxima of the profile, which wraps around at 180 degrees
+	int num_bins = sumHT.cols;
+	std::vector<std::pair<float, int>> candidates;
+	for (int c = 0; c < num_bins; c++) {
+		float v = sumHT.at<float>(0, c);
+		float left = sumHT.at<float>(0, (c - 1 + num_bins) % num_bins);
+		float right = sumHT.at<float>(0, (c + 1) % num_bins);
+		if (v < left || v <= right) continue;
+		if (v - min_votes < (max_votes - min_votes) * min_ratio) continue;
+		candidates.push_back(std::make_pair(v, c));
 	}
-	out.close();
-	*/
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
 
-	float max_votes = 0;
-	int max_angle;
-	for (int c = 0; c < sumHT.cols; c++) {
-		if (sumHT.at<float>(0, c) > max_votes) {
-			max_votes = sumHT.at<float>(0, c);
-			max_angle = c;
+	// non-maximum suppression modulo 90 degrees
+	int half = num_bins / 2;
+	int separation = std::round(min_separation / CV_PI * num_bins);
+	std::vector<int> peak_bins;
+	for (auto& candidate : candidates) {
+		if (peak_bins.size() >= max_peaks) break;
+
+		bool suppressed = false;
+		for (auto bin : peak_bins) {
+			int diff = std::abs(candidate.second - bin) % half;
+			if (std::min(diff, half - diff) < separation) {
+				suppressed = true;
+				break;
+			}
 		}
+		if (suppressed) continue;
+
+		peak_bins.push_back(candidate.second);
+		peaks.push_back(candidate.second / (float)num_bins * CV_PI);
 	}
 
-	return max_angle / 180.0f * CV_PI;
+	return peaks;
 }
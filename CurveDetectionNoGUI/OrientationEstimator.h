@@ -10,5 +10,10 @@ public:
 public:
 	static float estimate(const std::vector<std::vector<cv::Point2f>>& polygons);
 	static float estimate(const std::vector<cv::Point2f>& polygon);
+	static std::vector<float> estimatePeaks(const std::vector<std::vector<cv::Point2f>>& polygons, int max_peaks = 5, float min_separation = 10.0f / 180.0f * CV_PI, float min_ratio = 0.3f);
+
+private:
+	static cv::Mat votes(const std::vector<std::vector<cv::Point2f>>& polygons);
+	static std::vector<float> findPeaks(const cv::Mat& sumHT, int max_peaks, float min_separation, float min_ratio);
 };
 
@@ -0,0 +1,596 @@
+#include "Pipeline.h"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <chrono>
+#include <set>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+#include "BlockingQueue.h"
+#include "CenterlineExtractor.h"
+#include "OrientationEstimator.h"
+#include "Tracer.h"
+
+Parameters::Parameters() {
+	num_iter = 200000;
+	min_points = 200;
+	max_error_ratio_to_radius = 0.02f;
+	cluster_epsilon = 30;
+	min_angle = 90 / 180.0 * CV_PI;
+	min_radius = 80;
+	max_radius = 400;
+	line_num_iter = 10000;
+	line_min_points = 30;
+	line_max_error = 5;
+	line_cluster_epsilon = 20;
+	line_min_length = 30;
+}
+
+/**
+ * Set the parameter of the given name, where min_angle is given in degrees. Return false for an unknown name.
+ */
+bool Parameters::set(const std::string& name, float value) {
+	if (name == "num_iter") num_iter = value;
+	else if (name == "min_points") min_points = value;
+	else if (name == "max_error_ratio_to_radius") max_error_ratio_to_radius = value;
+	else if (name == "cluster_epsilon") cluster_epsilon = value;
+	else if (name == "min_angle") min_angle = value / 180.0 * CV_PI;
+	else if (name == "min_radius") min_radius = value;
+	else if (name == "max_radius") max_radius = value;
+	else if (name == "line_num_iter") line_num_iter = value;
+	else if (name == "line_min_points") line_min_points = value;
+	else if (name == "line_max_error") line_max_error = value;
+	else if (name == "line_cluster_epsilon") line_cluster_epsilon = value;
+	else if (name == "line_min_length") line_min_length = value;
+	else return false;
+
+	return true;
+}
+
+std::string Parameters::toJson() const {
+	std::ostringstream out;
+	out << "{\"num_iter\":" << num_iter << ",\"min_points\":" << min_points << ",\"max_error_ratio_to_radius\":" << max_error_ratio_to_radius
+		<< ",\"cluster_epsilon\":" << cluster_epsilon << ",\"min_angle\":" << min_angle / CV_PI * 180 << ",\"min_radius\":" << min_radius
+		<< ",\"max_radius\":" << max_radius << ",\"line_num_iter\":" << line_num_iter << ",\"line_min_points\":" << line_min_points
+		<< ",\"line_max_error\":" << line_max_error << ",\"line_cluster_epsilon\":" << line_cluster_epsilon << ",\"line_min_length\":" << line_min_length << "}";
+	return out.str();
+}
+
+/**
+ * Expand a grid such as "num_iter=10000,200000;cluster_epsilon=20,30" into every combination of its values,
+ * with the other parameters taken from base. The entries can also be given one per line in a file.
+ * Return false if the spec names an unknown parameter.
+ */
+bool Parameters::grid(const std::string& spec, const Parameters& base, std::vector<Parameters>& configs) {
+	std::string text = spec;
+	std::ifstream file(spec);
+	if (file.is_open()) {
+		std::stringstream contents;
+		contents << file.rdbuf();
+		text = contents.str();
+	}
+	std::replace(text.begin(), text.end(), '\n', ';');
+
+	configs.assign(1, base);
+	std::istringstream entries(text);
+	std::string entry;
+	while (std::getline(entries, entry, ';')) {
+		entry.erase(entry.find_last_not_of(" \t\r") + 1);
+		entry.erase(0, entry.find_first_not_of(" \t"));
+		if (entry.empty()) continue;
+
+		size_t equal = entry.find('=');
+		std::string name = entry.substr(0, equal);
+		std::vector<float> values;
+		if (equal != std::string::npos) {
+			std::istringstream list(entry.substr(equal + 1));
+			std::string value;
+			while (std::getline(list, value, ',')) values.push_back(std::atof(value.c_str()));
+		}
+		if (values.empty() || !Parameters().set(name, 0)) {
+			std::cerr << "Unknown parameter in grid: " << entry << std::endl;
+			return false;
+		}
+
+		// the last parameter varies fastest
+		std::vector<Parameters> expanded;
+		for (auto& config : configs) {
+			for (float value : values) {
+				expanded.push_back(config);
+				expanded.back().set(name, value);
+			}
+		}
+		configs.swap(expanded);
+	}
+
+	return true;
+}
+
+namespace {
+
+/**
+ * Return the seed of the generator of the detectors for contour i of an input, an FNV-1a hash of the input path
+ * and the contour index starting from the seed of the pipeline.
+ */
+uint64_t contourSeed(uint64_t seed, const std::string& input, int i) {
+	const uint64_t PRIME = 1099511628211ULL;
+	uint64_t h = 14695981039346656037ULL ^ seed;
+	for (unsigned char c : input) h = (h ^ c) * PRIME;
+	return (h ^ (uint64_t)i) * PRIME;
+}
+
+}
+
+Pipeline::Pipeline() : seed(0), resample_spacing(0), centerline(false), detect_lines(false), render(true), stats(false), writer(NULL), cache(NULL) {
+	num_workers = std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+/**
+ * Run every stage on a single image. Without a workspace, the contour extraction uses all the cores.
+ * Return false if the image cannot be decoded or the result image cannot be written.
+ */
+bool Pipeline::process(Job& job, Workspace* workspace) const {
+	if (!prepare(job, workspace)) return false;
+	detect(job);
+
+	return encode(job);
+}
+
+/**
+ * Decode the image and extract its contours, so that the detectors can be run on them with detectPolygon().
+ * Return false if the image cannot be decoded.
+ */
+bool Pipeline::prepare(Job& job, Workspace* workspace) const {
+	if (!decode(job)) return false;
+	extract(job, workspace);
+
+	return true;
+}
+
+/**
+ * Process the images with num_workers threads per stage, and write the results to output_dir, which is created
+ * if needed. Each queue between two stages holds at most num_workers images, which bounds the memory in flight.
+ * Return the number of images that were decoded and whose result image was written, or -1 if the output
+ * directory cannot be created.
+ */
+int Pipeline::run(const std::vector<std::string>& inputs, const std::string& output_dir) const {
+	if (render && !createDirectory(output_dir)) {
+		std::cerr << "Cannot create " << output_dir << std::endl;
+		return -1;
+	}
+	std::vector<std::string> outputs = outputPaths(inputs, output_dir);
+
+	typedef BlockingQueue<std::unique_ptr<Job>> Queue;
+	Queue decoded(num_workers);
+	Queue traced(num_workers);
+	Queue detected(num_workers);
+
+	std::vector<std::thread> threads;
+
+	// the last worker of a stage to finish closes the queue to the next one
+	auto startStage = [&](const std::function<void()>& work, Queue* output) {
+		std::shared_ptr<std::atomic<int>> count = std::make_shared<std::atomic<int>>(num_workers);
+		for (int i = 0; i < num_workers; i++) {
+			threads.push_back(std::thread([=]() {
+				work();
+				if (--*count == 0 && output != NULL) output->close();
+			}));
+		}
+	};
+
+	std::atomic<int> next_input(0);
+	std::atomic<int> num_written(0);
+	startStage([&]() {
+		for (int i = next_input++; i < inputs.size(); i = next_input++) {
+			std::unique_ptr<Job> job(new Job(inputs[i], outputs[i]));
+			if (!decode(*job)) continue;
+			decoded.push(std::move(job));
+		}
+	}, &decoded);
+
+	startStage([&]() {
+		// contours are traced on the runs with one thread per image, since the images themselves run in parallel
+		Workspace workspace;
+		std::unique_ptr<Job> job;
+		while (decoded.pop(job)) {
+			extract(*job, &workspace);
+			traced.push(std::move(job));
+		}
+	}, &traced);
+
+	startStage([&]() {
+		std::unique_ptr<Job> job;
+		while (traced.pop(job)) {
+			detect(*job);
+			detected.push(std::move(job));
+		}
+	}, &detected);
+
+	startStage([&]() {
+		std::unique_ptr<Job> job;
+		while (detected.pop(job)) {
+			if (encode(*job)) num_written++;
+		}
+	}, NULL);
+
+	for (auto& thread : threads) thread.join();
+
+	return num_written;
+}
+
+/**
+ * Run every configuration on each image, decoding it and extracting its contours only once.
+ * The configurations and the contours of each image are processed in parallel on num_workers threads, on private
+ * copies of the points, since the detectors mark the points they use. Each task seeds its generator from the image
+ * and the contour as detectPolygon() does in a batch, so the results of a configuration do not depend on the
+ * scheduling and match a batch run with the same parameters. With a writer, each configuration of an image gets its own image
+ * id, followed by a config record with its parameters and detection time. A summary per configuration goes to
+ * the standard error. Return the number of images that could be decoded.
+ */
+int Pipeline::sweep(const std::vector<std::string>& inputs, const std::vector<Parameters>& configs) const {
+	std::vector<double> total_ms(configs.size(), 0);
+	std::vector<int> total_circles(configs.size(), 0);
+	std::vector<int> total_lines(configs.size(), 0);
+	double extract_ms = 0;
+	int num_decoded = 0;
+
+	// the detection runs on the workers requested, rather than on every core that OpenCV would use
+	int num_threads = cv::getNumThreads();
+	cv::setNumThreads(num_workers);
+
+	for (auto& input : inputs) {
+		Job job(input, "");
+		auto start = std::chrono::steady_clock::now();
+		if (!decode(job)) continue;
+		extract(job, NULL);
+		extract_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		num_decoded++;
+
+		const PolygonSet& contours = resample_spacing > 1 ? job.resampled : job.polygons;
+		std::vector<float> principal_orientations = principalOrientations(contours);
+
+		std::vector<int> ids(configs.size(), -1);
+		if (writer != NULL) {
+			for (int k = 0; k < configs.size(); k++) ids[k] = writer->beginImage(job.input, job.size.width, job.size.height);
+		}
+
+		// every pair of a configuration and a contour is an independent task
+		int num_contours = contours.size();
+		std::vector<double> ms(configs.size() * num_contours, 0);
+		std::vector<int> num_circles(ms.size(), 0);
+		std::vector<int> num_lines(ms.size(), 0);
+		cv::parallel_for_(cv::Range(0, (int)ms.size()), [&](const cv::Range& range) {
+			std::vector<Point> buffer;
+			std::vector<Circle> circles;
+			std::vector<Line> lines;
+			for (int t = range.start; t < range.end; t++) {
+				int k = t / num_contours;
+				int i = t % num_contours;
+
+				auto start = std::chrono::steady_clock::now();
+				detectPolygon(job, i, configs[k], principal_orientations, buffer, circles, lines);
+				ms[t] = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				num_circles[t] = circles.size();
+				num_lines[t] = lines.size();
+
+				if (writer != NULL) writer->write(ids[k], i, circles, lines);
+			}
+		});
+
+		for (int k = 0; k < configs.size(); k++) {
+			double config_ms = 0;
+			int config_circles = 0;
+			int config_lines = 0;
+			for (int i = 0; i < num_contours; i++) {
+				config_ms += ms[k * num_contours + i];
+				config_circles += num_circles[k * num_contours + i];
+				config_lines += num_lines[k * num_contours + i];
+			}
+			total_ms[k] += config_ms;
+			total_circles[k] += config_circles;
+			total_lines[k] += config_lines;
+
+			if (writer != NULL) {
+				writer->endImage(ids[k], config_circles, config_lines);
+				writer->writeConfig(ids[k], k, configs[k].toJson(), config_ms);
+			}
+		}
+	}
+	cv::setNumThreads(num_threads);
+
+	std::cerr << "Extracted the contours of " << num_decoded << " images once in " << extract_ms << " ms" << std::endl;
+	for (int k = 0; k < configs.size(); k++) {
+		std::cerr << "config " << k << " " << configs[k].toJson() << ": " << total_ms[k] << " ms, " << total_circles[k] << " circles, " << total_lines[k] << " lines" << std::endl;
+	}
+
+	return num_decoded;
+}
+
+/**
+ * List the images of a directory, of a glob pattern such as scans/<name>.png with wildcards in the name, or of
+ * a manifest file that names one image per line.
+ */
+std::vector<std::string> Pipeline::listInputs(const std::string& source) {
+	static const char* EXTENSIONS[] = { ".png", ".jpg", ".jpeg", ".bmp", ".tif", ".tiff", ".pgm", ".pbm", ".ppm" };
+	auto isImage = [](const std::string& path) {
+		size_t dot = path.find_last_of('.');
+		if (dot == std::string::npos) return false;
+		std::string extension = path.substr(dot);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+		return std::find(std::begin(EXTENSIONS), std::end(EXTENSIONS), extension) != std::end(EXTENSIONS);
+	};
+
+	std::vector<cv::String> paths;
+	cv::glob(source, paths, false);
+
+	std::vector<std::string> inputs;
+	if (paths.size() == 1 && paths[0] == source && !isImage(source)) {
+		std::ifstream manifest(source);
+		std::string line;
+		while (std::getline(manifest, line)) {
+			line.erase(line.find_last_not_of(" \t\r") + 1);
+			if (!line.empty()) inputs.push_back(line);
+		}
+	}
+	else {
+		for (auto& path : paths) {
+			if (isImage(path)) inputs.push_back(path);
+		}
+	}
+
+	return inputs;
+}
+
+/**
+ * Return the paths of the result images for the inputs, each named after its input in output_dir. Inputs with the
+ * same name but another directory or extension, such as a/x.png and b/x.jpg, get a suffix such as x-2.png, so that
+ * no result overwrites another. The names are compared regardless of case, as on Windows.
+ */
+std::vector<std::string> Pipeline::outputPaths(const std::vector<std::string>& inputs, const std::string& output_dir) {
+	std::vector<std::string> outputs;
+	std::set<std::string> taken;
+	for (auto& input : inputs) {
+		size_t slash = input.find_last_of("/\\");
+		std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+		size_t dot = name.find_last_of('.');
+		if (dot != std::string::npos) name = name.substr(0, dot);
+
+		std::string unique = name;
+		for (int n = 2; ; n++) {
+			std::string key = unique;
+			std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+			if (taken.insert(key).second) break;
+			unique = name + "-" + std::to_string(n);
+		}
+		outputs.push_back(output_dir + "/" + unique + ".png");
+	}
+
+	return outputs;
+}
+
+/**
+ * Create the directory unless it exists. Return false if it cannot be created or is not a directory. Only the
+ * last component is created.
+ */
+bool Pipeline::createDirectory(const std::string& path) {
+#ifdef _WIN32
+	struct _stat info;
+	if (_stat(path.c_str(), &info) == 0) return (info.st_mode & _S_IFDIR) != 0;
+	return _mkdir(path.c_str()) == 0;
+#else
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0) return S_ISDIR(info.st_mode);
+	return mkdir(path.c_str(), 0777) == 0;
+#endif
+}
+
+/**
+ * Read the image, from its encoded bytes if the job already holds them, unless the job already holds the pixels.
+ * With a cache, the encoded bytes are hashed first, and an image whose contours are cached is only decoded if it
+ * has to be rendered.
+ */
+bool Pipeline::decode(Job& job) const {
+	// the image was handed over as raw pixels, such as in shared memory
+	if (!job.image.empty()) {
+		job.size = job.image.size();
+		return true;
+	}
+
+	TraceScope trace("decode");
+
+	if (cache != NULL) {
+		if (job.data.empty()) {
+			std::ifstream file(job.input, std::ios::in | std::ios::binary);
+			job.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		}
+
+		// everything that changes the extracted contours goes into the key
+		char settings[64];
+		sprintf(settings, "threshold=40 min_points=100 centerline=%d", centerline ? 1 : 0);
+		job.cache_key = cache->key(job.data, settings);
+		job.cached = !job.data.empty() && cache->load(job.cache_key, job.polygons, job.size);
+		if (job.cached && !render) return true;
+	}
+
+	if (!job.data.empty()) job.image = cv::imdecode(job.data, cv::IMREAD_GRAYSCALE);
+	else if (cache == NULL) job.image = cv::imread(job.input, cv::IMREAD_GRAYSCALE);
+
+	if (job.image.empty()) {
+		std::cerr << "Cannot read " << job.input << std::endl;
+		return false;
+	}
+	job.size = job.image.size();
+
+	return true;
+}
+
+/**
+ * Find the contours, or the centerlines of thin strokes, with at least 100 points, unless they came from the cache.
+ * Without a workspace, the contours are traced in parallel tiles.
+ */
+void Pipeline::extract(Job& job, Workspace* workspace) const {
+	if (!job.cached) {
+		if (centerline) {
+			TraceScope trace("extractCenterlines");
+			cv::Mat buffer;
+			CenterlineExtractor::extract(ImageView(job.image), workspace != NULL ? workspace->buffer : buffer, job.polygons, 100);
+		}
+		else if (workspace != NULL) {
+			{
+				TraceScope trace("threshold");
+				workspace->binary_image.create(ImageView(job.image));
+			}
+			TraceScope trace("findContours");
+			findContours(workspace->binary_image, job.polygons, 100);
+		}
+		else {
+			// the tiles are thresholded as they are traced
+			TraceScope trace("findContoursTiled");
+			findContoursTiled(ImageView(job.image), job.polygons, 100);
+		}
+
+		if (cache != NULL && !job.cache_key.empty()) cache->store(job.cache_key, job.polygons, job.size);
+	}
+
+	// thin out the smooth parts of the contours
+	if (resample_spacing > 1) {
+		TraceScope trace("resampleContours");
+		resampleContours(job.polygons, job.resampled, resample_spacing);
+	}
+}
+
+/**
+ * Detect the circles in each contour, and then the lines in the points that no circle took.
+ * With stats set, the detector counters of each polygon and of the whole image are written as stats records,
+ * and those of the image are also printed to the standard error.
+ */
+void Pipeline::detect(Job& job) const {
+	const PolygonSet& contours = resample_spacing > 1 ? job.resampled : job.polygons;
+	std::vector<float> principal_orientations = principalOrientations(contours);
+
+	int id = writer != NULL ? writer->beginImage(job.input, job.size.width, job.size.height) : -1;
+
+	job.circles.clear();
+	job.lines.clear();
+	std::vector<Point> buffer;
+	std::vector<Circle> circles;
+	std::vector<Line> lines;
+	DetectorStats circle_stats, line_stats;
+	DetectorStats image_circle_stats, image_line_stats;
+
+	// each primitive is written as soon as its round accepts it, rather than after its polygon is done
+	int polygon = -1;
+	DetectionControl control;
+	if (writer != NULL) {
+		control.on_circle = [&](const Circle& circle) { writer->write(id, polygon, circle); };
+		control.on_line = [&](const Line& line) { writer->write(id, polygon, line); };
+	}
+
+	for (int i = 0; i < contours.size(); i++) {
+		circle_stats.clear();
+		line_stats.clear();
+		polygon = i;
+		detectPolygon(job, i, params, principal_orientations, buffer, circles, lines, stats ? &circle_stats : NULL, stats ? &line_stats : NULL, writer != NULL ? &control : NULL);
+		job.circles.insert(job.circles.end(), circles.begin(), circles.end());
+		job.lines.insert(job.lines.end(), lines.begin(), lines.end());
+
+		if (stats) {
+			if (writer != NULL) writer->writeStats(id, i, circle_stats, line_stats);
+			image_circle_stats.add(circle_stats);
+			image_line_stats.add(line_stats);
+		}
+	}
+
+	if (stats) {
+		if (writer != NULL) writer->writeStats(id, -1, image_circle_stats, image_line_stats);
+		std::cerr << job.input << ": circles " << image_circle_stats.toJson() << std::endl;
+		if (detect_lines) std::cerr << job.input << ": lines " << image_line_stats.toJson() << std::endl;
+	}
+	if (writer != NULL) writer->endImage(id, job.circles.size(), job.lines.size());
+}
+
+/**
+ * Return the principal orientations of the contours, to which the lines are snapped, if lines are detected.
+ */
+std::vector<float> Pipeline::principalOrientations(const PolygonSet& contours) const {
+	if (!detect_lines) return std::vector<float>();
+
+	TraceScope trace("estimateOrientations");
+	std::vector<std::vector<cv::Point2f>> pgons(contours.size());
+	for (int i = 0; i < contours.size(); i++) {
+		for (int j = 0; j < contours.contourSize(i); j++) pgons[i].push_back(contours.contour(i)[j].pos);
+	}
+	return OrientationEstimator::estimatePeaks(pgons);
+}
+
+/**
+ * Detect the primitives of the i-th contour of the job with the given parameters.
+ * The detectors work on a copy of the contour in buffer, so the contours of the job are never modified.
+ */
+void Pipeline::detectPolygon(const Job& job, int i, const Parameters& params, const std::vector<float>& principal_orientations, std::vector<Point>& buffer, std::vector<Circle>& circles, std::vector<Line>& lines, DetectorStats* circle_stats, DetectorStats* line_stats, DetectionControl* control) const {
+	TraceScope trace("detectPolygon", i);
+	const PolygonSet& contours = resample_spacing > 1 ? job.resampled : job.polygons;
+	cv::RNG rng(contourSeed(seed, job.input, i));
+	buffer.assign(contours.contour(i), contours.contour(i) + contours.contourSize(i));
+
+	// the point counts and index distances stand for arc lengths, which hold fewer points once resampled
+	float density = resample_spacing > 1 ? resampledDensity(resample_spacing) : 1.0f;
+
+	CurveDetector::detect(buffer.data(), buffer.size(), contours.isContourClosed(i), params.num_iter, std::round(params.min_points * density), params.max_error_ratio_to_radius, std::max(1.0f, params.cluster_epsilon * density), params.min_angle, params.min_radius, params.max_radius, circles, rng, circle_stats, control);
+
+	lines.clear();
+	if (detect_lines) {
+		LineDetector::detect(buffer.data(), buffer.size(), contours.isContourClosed(i), params.line_num_iter, std::round(params.line_min_points * density), params.line_max_error, std::max(1.0f, params.line_cluster_epsilon * density), params.line_min_length, principal_orientations, lines, rng, line_stats, control);
+	}
+}
+
+/**
+ * Render the contours and the primitives of the job and write them to its output path, if there are any.
+ * Return false if the image cannot be written.
+ */
+bool Pipeline::encode(Job& job) const {
+	if (!render) return true;
+
+	if (job.circles.size() > 0 || job.lines.size() > 0) {
+		TraceScope trace("render");
+
+		// generate output image
+		cv::Mat result(job.size, CV_8UC3, cv::Scalar(255, 255, 255));
+		for (int r = 0; r < job.polygons.numRings(); r++) {
+			std::vector<cv::Point> pol;
+			for (int j = 0; j < job.polygons.ringSize(r); j++) pol.push_back(job.polygons.ring(r)[j].pos);
+			cv::polylines(result, pol, job.polygons.isClosed(r), cv::Scalar(0, 0, 0), 1);
+		}
+		for (auto& circle : job.circles) {
+			cv::ellipse(result, cv::Point(circle.center.x, circle.center.y), cv::Size(circle.radius, circle.radius), 0, circle.start_angle / CV_PI * 180, circle.end_angle / CV_PI * 180, cv::Scalar(255, 0, 0), 3);
+		}
+		for (auto& line : job.lines) {
+			cv::Point2f p1 = line.point + line.dir * line.start_pos;
+			cv::Point2f p2 = line.point + line.dir * line.end_pos;
+			cv::line(result, p1, p2, cv::Scalar(0, 0, 255), 3);
+		}
+
+		TraceScope trace_imwrite("imwrite");
+		bool written;
+		try {
+			written = cv::imwrite(job.output, result);
+		}
+		catch (const cv::Exception&) {
+			written = false;
+		}
+		if (!written) {
+			std::cerr << "Cannot write " << job.output << std::endl;
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "CurveDetector.h"
+#include "LineDetector.h"
+#include "ResultWriter.h"
+#include "ContourCache.h"
+
+/**
+ * One image on its way through the pipeline.
+ */
+class Job {
+public:
+	std::string input;
+	std::string output;
+	std::vector<uchar> data;
+	cv::Mat image;
+	cv::Size size;
+	std::string cache_key;
+	bool cached;
+	PolygonSet polygons;
+	PolygonSet resampled;
+	std::vector<Circle> circles;
+	std::vector<Line> lines;
+
+public:
+	Job() : cached(false) {}
+	Job(const std::string& input, const std::string& output) : input(input), output(output), cached(false) {}
+};
+
+/**
+ * Arguments of the curve and line detectors. The point counts and index distances apply to contours at full
+ * density, and are scaled down for resampled ones. min_angle is in radians.
+ */
+class Parameters {
+public:
+	int num_iter;
+	int min_points;
+	float max_error_ratio_to_radius;
+	float cluster_epsilon;
+	float min_angle;
+	float min_radius;
+	float max_radius;
+	int line_num_iter;
+	int line_min_points;
+	float line_max_error;
+	float line_cluster_epsilon;
+	float line_min_length;
+
+public:
+	Parameters();
+
+	bool set(const std::string& name, float value);
+	std::string toJson() const;
+	static bool grid(const std::string& spec, const Parameters& base, std::vector<Parameters>& configs);
+};
+
+/**
+ * Scratch buffers that a worker reuses across images, so that it stops allocating once they have grown.
+ */
+class Workspace {
+public:
+	RunLengthImage binary_image;
+	cv::Mat buffer;
+};
+
+/**
+ * Detect the circles, and optionally the lines, in drawings, either one image at a time, or in batches where decoding,
+ * contour extraction, detection and writing run as overlapping stages connected by bounded queues.
+ * The primitives are streamed to the writer, if any, as each polygon is processed, and the rendered result image
+ * is written unless render is false. With a cache, the contours of images that were seen before are loaded from it,
+ * and such images are not even decoded when nothing is rendered.
+ * The detectors draw their samples from a generator seeded from seed, the input path and the contour index, so that
+ * the results of a contour are the same whatever the number of workers and the order in which they take it.
+ */
+class Pipeline {
+public:
+	int num_workers;
+	uint64_t seed;
+	float resample_spacing;
+	bool centerline;
+	bool detect_lines;
+	bool render;
+	bool stats;
+	Parameters params;
+	ResultWriter* writer;
+	ContourCache* cache;
+
+public:
+	Pipeline();
+
+	bool process(Job& job, Workspace* workspace = NULL) const;
+	bool prepare(Job& job, Workspace* workspace = NULL) const;
+	int run(const std::vector<std::string>& inputs, const std::string& output_dir) const;
+	int sweep(const std::vector<std::string>& inputs, const std::vector<Parameters>& configs) const;
+	static std::vector<std::string> listInputs(const std::string& source);
+	static std::vector<std::string> outputPaths(const std::vector<std::string>& inputs, const std::string& output_dir);
+	static bool createDirectory(const std::string& path);
+	std::vector<float> principalOrientations(const PolygonSet& contours) const;
+	void detectPolygon(const Job& job, int i, const Parameters& params, const std::vector<float>& principal_orientations, std::vector<Point>& buffer, std::vector<Circle>& circles, std::vector<Line>& lines, DetectorStats* circle_stats = NULL, DetectorStats* line_stats = NULL, DetectionControl* control = NULL) const;
+
+private:
+	bool decode(Job& job) const;
+	void extract(Job& job, Workspace* workspace) const;
+	void detect(Job& job) const;
+	bool encode(Job& job) const;
+};
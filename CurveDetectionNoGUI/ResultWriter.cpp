@@ -0,0 +1,259 @@
+#include "ResultWriter.h"
+#include <iostream>
+#include <cstdio>
+#include <cmath>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
+
+namespace {
+
+/**
+ * Format a number of an NDJSON record with 6 significant digits. JSON has no NaN or infinity, so a degenerate
+ * primitive, such as a circle fitted to collinear points, gets null for those values instead.
+ */
+std::string number(double value) {
+	if (!std::isfinite(value)) return "null";
+	char buf[32];
+	sprintf(buf, "%.6g", value);
+	return buf;
+}
+
+}
+
+/**
+ * Open the stream, where "-" is the standard output.
+ */
+bool ResultWriter::open(const std::string& path, Format format) {
+	this->format = format;
+	num_images = 0;
+
+	if (path == "-") {
+#ifdef _WIN32
+		// keep the standard output from translating the line feeds in the binary records
+		if (format == BINARY) _setmode(_fileno(stdout), _O_BINARY);
+#endif
+		out = &std::cout;
+	}
+	else {
+		file.open(path, format == BINARY ? std::ios::out | std::ios::binary : std::ios::out);
+		if (!file.is_open()) return false;
+		out = &file;
+	}
+
+	if (format == BINARY) out->write("CDR1", 4);
+	return true;
+}
+
+/**
+ * Write to a stream that the caller owns, such as a socket connection.
+ */
+void ResultWriter::open(std::ostream& stream, Format format) {
+	this->format = format;
+	num_images = 0;
+	out = &stream;
+
+	if (format == BINARY) out->write("CDR1", 4);
+}
+
+void ResultWriter::close() {
+	if (out == NULL) return;
+
+	out->flush();
+	if (file.is_open()) file.close();
+	out = NULL;
+}
+
+/**
+ * Write the record that introduces an image, and return the id that its other records refer to.
+ */
+int ResultWriter::beginImage(const std::string& path, int width, int height) {
+	std::lock_guard<std::mutex> lock(mutex);
+	int id = num_images++;
+
+	if (format == NDJSON) {
+		*out << "{\"type\":\"image\",\"id\":" << id << ",\"path\":\"" << escape(path) << "\",\"width\":" << width << ",\"height\":" << height << "}\n";
+	}
+	else {
+		put<uchar>(1);
+		put<uint32_t>(id);
+		put<int32_t>(width);
+		put<int32_t>(height);
+		put<uint32_t>(path.size());
+		out->write(path.data(), path.size());
+	}
+
+	return id;
+}
+
+/**
+ * Write the primitives detected in one polygon of the image and flush them.
+ */
+void ResultWriter::write(int image, int polygon, const std::vector<Circle>& circles, const std::vector<Line>& lines) {
+	if (circles.size() == 0 && lines.size() == 0) return;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto& circle : circles) putCircle(image, polygon, circle);
+	for (auto& line : lines) putLine(image, polygon, line);
+
+	out->flush();
+}
+
+/**
+ * Write a circle as soon as the detector accepts it and flush it, for streaming the results of a polygon while
+ * it is still being processed.
+ */
+void ResultWriter::write(int image, int polygon, const Circle& circle) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	putCircle(image, polygon, circle);
+	out->flush();
+}
+
+void ResultWriter::write(int image, int polygon, const Line& line) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	putLine(image, polygon, line);
+	out->flush();
+}
+
+void ResultWriter::putCircle(int image, int polygon, const Circle& circle) {
+	if (format == NDJSON) {
+		*out << "{\"type\":\"circle\",\"image\":" << image << ",\"polygon\":" << polygon << ",\"center\":[" << number(circle.center.x) << "," << number(circle.center.y)
+			<< "],\"radius\":" << number(circle.radius) << ",\"start_angle\":" << number(circle.start_angle) << ",\"end_angle\":" << number(circle.end_angle)
+			<< ",\"inliers\":" << circle.points.size() << "}\n";
+	}
+	else {
+		put<uchar>(2);
+		put<uint32_t>(image);
+		put<int32_t>(polygon);
+		put<float>(circle.center.x);
+		put<float>(circle.center.y);
+		put<float>(circle.radius);
+		put<float>(circle.start_angle);
+		put<float>(circle.end_angle);
+		put<uint32_t>(circle.points.size());
+	}
+}
+
+void ResultWriter::putLine(int image, int polygon, const Line& line) {
+	cv::Point2f p1 = line.point + line.dir * line.start_pos;
+	cv::Point2f p2 = line.point + line.dir * line.end_pos;
+	if (format == NDJSON) {
+		*out << "{\"type\":\"line\",\"image\":" << image << ",\"polygon\":" << polygon << ",\"p1\":[" << number(p1.x) << "," << number(p1.y)
+			<< "],\"p2\":[" << number(p2.x) << "," << number(p2.y) << "],\"dir\":[" << number(line.dir.x) << "," << number(line.dir.y)
+			<< "],\"inliers\":" << line.points.size() << "}\n";
+	}
+	else {
+		put<uchar>(3);
+		put<uint32_t>(image);
+		put<int32_t>(polygon);
+		put<float>(p1.x);
+		put<float>(p1.y);
+		put<float>(p2.x);
+		put<float>(p2.y);
+		put<float>(line.dir.x);
+		put<float>(line.dir.y);
+		put<uint32_t>(line.points.size());
+	}
+}
+
+/**
+ * Write the record that tells the readers that the image is complete.
+ */
+void ResultWriter::endImage(int image, int num_circles, int num_lines) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (format == NDJSON) {
+		*out << "{\"type\":\"end\",\"image\":" << image << ",\"circles\":" << num_circles << ",\"lines\":" << num_lines << "}\n";
+	}
+	else {
+		put<uchar>(4);
+		put<uint32_t>(image);
+		put<uint32_t>(num_circles);
+		put<uint32_t>(num_lines);
+	}
+	out->flush();
+}
+
+/**
+ * Write which configuration of a sweep produced the image id, and how long its detection took.
+ */
+void ResultWriter::writeConfig(int image, int config, const std::string& params_json, double detect_ms) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (format == NDJSON) {
+		*out << "{\"type\":\"config\",\"image\":" << image << ",\"config\":" << config << ",\"detect_ms\":" << number(detect_ms) << ",\"params\":" << params_json << "}\n";
+	}
+	else {
+		put<uchar>(5);
+		put<uint32_t>(image);
+		put<uint32_t>(config);
+		put<float>(detect_ms);
+	}
+	out->flush();
+}
+
+void ResultWriter::writeError(const std::string& message) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (format == NDJSON) {
+		*out << "{\"type\":\"error\",\"message\":\"" << escape(message) << "\"}\n";
+	}
+	else {
+		put<uchar>(6);
+		put<uint32_t>(message.size());
+		out->write(message.data(), message.size());
+	}
+	out->flush();
+}
+
+/**
+ * Write the detector counters of a polygon, or of the whole image if polygon is -1.
+ */
+void ResultWriter::writeStats(int image, int polygon, const DetectorStats& circle_stats, const DetectorStats& line_stats) {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if (format == NDJSON) {
+		*out << "{\"type\":\"stats\",\"image\":" << image << ",\"polygon\":" << polygon << ",\"circles\":" << circle_stats.toJson() << ",\"lines\":" << line_stats.toJson() << "}\n";
+	}
+	else {
+		put<uchar>(7);
+		put<uint32_t>(image);
+		put<int32_t>(polygon);
+		putStats(circle_stats);
+		putStats(line_stats);
+	}
+	out->flush();
+}
+
+void ResultWriter::putStats(const DetectorStats& stats) {
+	put<int64_t>(stats.rounds);
+	put<int64_t>(stats.hypotheses);
+	put<int64_t>(stats.sampling_retries);
+	put<int64_t>(stats.collinear);
+	put<int64_t>(stats.radius_range);
+	put<int64_t>(stats.angle_range);
+	put<int64_t>(stats.normal);
+	put<int64_t>(stats.length);
+	put<int64_t>(stats.points_walked);
+	put<int64_t>(stats.accepted);
+}
+
+std::string ResultWriter::escape(const std::string& str) {
+	std::string escaped;
+	for (char c : str) {
+		if (c == '"' || c == '\\') escaped += '\\';
+		if ((unsigned char)c < 0x20) {
+			char buf[8];
+			sprintf(buf, "\\u%04x", c);
+			escaped += buf;
+		}
+		else {
+			escaped += c;
+		}
+	}
+	return escaped;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <string>
+#include <fstream>
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include "CurveDetector.h"
+#include "LineDetector.h"
+
+/**
+ * Streams the detected primitives as records, so that downstream tools do not need to re-detect them from the
+ * rendered images. Each image starts with an image record that assigns it an id, followed by the circle and line
+ * records of its polygons, and ends with an end record. The records of each polygon are flushed as soon as it has
+ * been processed, or each primitive as soon as it has been detected when streaming, and the records of different
+ * images may interleave when several workers share the writer.
+ *
+ * NDJSON writes one JSON object per line:
+ *   {"type":"image","id":0,"path":"a.png","width":800,"height":600}
+ *   {"type":"circle","image":0,"polygon":2,"center":[x,y],"radius":r,"start_angle":a,"end_angle":b,"inliers":n}
+ *   {"type":"line","image":0,"polygon":2,"p1":[x,y],"p2":[x,y],"dir":[x,y],"inliers":n}
+ *   {"type":"end","image":0,"circles":1,"lines":4}
+ *   {"type":"config","image":0,"config":3,"detect_ms":12.5,"params":{"num_iter":200000,...}}
+ *   {"type":"error","message":"Cannot read a.png"}
+ *   {"type":"stats","image":0,"polygon":2,"circles":{"rounds":2,"hypotheses":199871,...},"lines":{...}}
+ *
+ * BINARY starts with the 4 bytes "CDR1" followed by the same records, each one a type byte (1 image, 2 circle,
+ * 3 line, 4 end, 5 config, 6 error, 7 stats) and packed fields, which are little-endian whatever the host:
+ *   image:  uint32 id, int32 width, int32 height, uint32 path length, char path[length]
+ *   circle: uint32 image, int32 polygon, float cx, cy, radius, start_angle, end_angle, uint32 inliers
+ *   line:   uint32 image, int32 polygon, float x1, y1, x2, y2, dx, dy, uint32 inliers
+ *   end:    uint32 image, uint32 circles, uint32 lines
+ *   config: uint32 image, uint32 config, float detect_ms
+ *   error:  uint32 message length, char message[length]
+ *   stats:  uint32 image, int32 polygon, int64 circle counters[10], int64 line counters[10], in the order of DetectorStats
+ * Config records only appear in sweeps, after the end record of each configuration of an image, and error records
+ * only in the replies of the daemon, in place of the records of an image that could not be processed. Stats records
+ * are written when the counters are requested, for each polygon and then with polygon -1 for the whole image.
+ */
+class ResultWriter {
+public:
+	enum Format { NDJSON = 0, BINARY };
+
+private:
+	Format format;
+	std::ofstream file;
+	std::ostream* out;
+	int num_images;
+	std::mutex mutex;
+
+public:
+	ResultWriter() : format(NDJSON), out(NULL), num_images(0) {}
+
+	bool open(const std::string& path, Format format);
+	void open(std::ostream& stream, Format format);
+	void close();
+	int beginImage(const std::string& path, int width, int height);
+	void write(int image, int polygon, const std::vector<Circle>& circles, const std::vector<Line>& lines);
+	void write(int image, int polygon, const Circle& circle);
+	void write(int image, int polygon, const Line& line);
+	void endImage(int image, int num_circles, int num_lines);
+	void writeConfig(int image, int config, const std::string& params_json, double detect_ms);
+	void writeError(const std::string& message);
+	void writeStats(int image, int polygon, const DetectorStats& circle_stats, const DetectorStats& line_stats);
+	static std::string escape(const std::string& str);
+
+private:
+	/**
+	 * Write the value in little-endian byte order, swapping its bytes on a big-endian host.
+	 */
+	template<typename T>
+	void put(const T& value) {
+		char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+		if (isBigEndian()) std::reverse(bytes, bytes + sizeof(T));
+		out->write(bytes, sizeof(T));
+	}
+	static bool isBigEndian() {
+		const uint16_t one = 1;
+		return *(const uchar*)&one == 0;
+	}
+	void putCircle(int image, int polygon, const Circle& circle);
+	void putLine(int image, int polygon, const Line& line);
+	void putStats(const DetectorStats& stats);
+};
@@ -0,0 +1,214 @@
+#include "Tracer.h"
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <fstream>
+#include <algorithm>
+#include <limits>
+#include <new>
+#include <cstdlib>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <chrono>
+#include <sys/resource.h>
+#endif
+
+#ifdef _MSC_VER
+#define TRACER_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACER_THREAD_LOCAL __thread
+#endif
+
+namespace {
+
+struct Event {
+	const char* name;
+	int64_t begin;
+	int64_t end;
+	int arg;
+	int64_t allocations;
+	int64_t bytes;
+	int64_t peak_resident_kb;
+};
+
+/**
+ * Events of one thread, which only that thread appends to.
+ */
+struct ThreadBuffer {
+	int tid;
+	std::vector<Event> events;
+};
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<ThreadBuffer>> registry;
+TRACER_THREAD_LOCAL ThreadBuffer* thread_buffer = NULL;
+TRACER_THREAD_LOCAL int64_t thread_allocations = 0;
+TRACER_THREAD_LOCAL int64_t thread_bytes = 0;
+
+#ifdef _WIN32
+int64_t queryFrequency() {
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	return frequency.QuadPart;
+}
+
+// initialized before main(), since VS2013 does not initialize local statics thread-safely
+const int64_t frequency = queryFrequency();
+#endif
+
+}
+
+#ifdef CURVE_DETECTION_ALLOC_TRACKING
+// every allocation of the program is counted for the thread that makes it; the counters are plain thread-locals,
+// so counting costs no lock and works before the tracer has started
+void* operator new(size_t size) {
+	thread_allocations++;
+	thread_bytes += size;
+	void* ptr = std::malloc(size > 0 ? size : 1);
+	if (ptr == NULL) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size) {
+	return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw() {
+	thread_allocations++;
+	thread_bytes += size;
+	return std::malloc(size > 0 ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) throw() {
+	return operator new(size, nothrow);
+}
+
+void operator delete(void* ptr) throw() {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) throw() {
+	std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) throw() {
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) throw() {
+	std::free(ptr);
+}
+#endif
+
+bool Tracer::recording = false;
+
+void Tracer::start() {
+	recording = true;
+}
+
+/**
+ * Return the current time in microseconds.
+ * steady_clock is only as precise as the system clock in VS2013, so the performance counter is used on Windows.
+ */
+int64_t Tracer::now() {
+#ifdef _WIN32
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart / frequency * 1000000 + counter.QuadPart % frequency * 1000000 / frequency;
+#else
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+bool Tracer::tracksAllocations() {
+#ifdef CURVE_DETECTION_ALLOC_TRACKING
+	return true;
+#else
+	return false;
+#endif
+}
+
+/**
+ * Return the allocations that the calling thread has made since it started.
+ */
+AllocationCount Tracer::allocations() {
+	AllocationCount count;
+	count.allocations = thread_allocations;
+	count.bytes = thread_bytes;
+	return count;
+}
+
+/**
+ * Return the largest resident memory of the process so far in kilobytes.
+ */
+int64_t Tracer::peakResidentKB() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+	return counters.PeakWorkingSetSize / 1024;
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+	return usage.ru_maxrss;
+#endif
+}
+
+void Tracer::record(const char* name, int64_t begin, int64_t end, int arg, const AllocationCount& begin_allocations) {
+	Event event = { name, begin, end, arg, thread_allocations - begin_allocations.allocations, thread_bytes - begin_allocations.bytes, 0 };
+	if (tracksAllocations()) event.peak_resident_kb = peakResidentKB();
+
+	// the allocations of the tracer itself are not counted, so that they do not show up in the enclosing events
+	int64_t allocations = thread_allocations;
+	int64_t bytes = thread_bytes;
+	if (thread_buffer == NULL) {
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		registry.push_back(std::unique_ptr<ThreadBuffer>(new ThreadBuffer()));
+		registry.back()->tid = registry.size() - 1;
+		thread_buffer = registry.back().get();
+	}
+
+	thread_buffer->events.push_back(event);
+	thread_allocations = allocations;
+	thread_bytes = bytes;
+}
+
+/**
+ * Write the events of all the threads as complete ("X") events, with the times relative to the first event.
+ */
+bool Tracer::write(const std::string& path) {
+	std::ofstream out(path);
+	if (!out.is_open()) return false;
+
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	int64_t origin = std::numeric_limits<int64_t>::max();
+	for (auto& buffer : registry) {
+		for (auto& event : buffer->events) origin = std::min(origin, event.begin);
+	}
+
+	out << "{\"traceEvents\":[";
+	bool first = true;
+	for (auto& buffer : registry) {
+		out << (first ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+		first = false;
+		for (auto& event : buffer->events) {
+			out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << ",\"ts\":" << event.begin - origin << ",\"dur\":" << event.end - event.begin;
+			if (tracksAllocations()) {
+				out << ",\"args\":{";
+				if (event.arg >= 0) out << "\"index\":" << event.arg << ",";
+				out << "\"allocations\":" << event.allocations << ",\"bytes\":" << event.bytes << ",\"peak_resident_kb\":" << event.peak_resident_kb << "}";
+			}
+			else if (event.arg >= 0) {
+				out << ",\"args\":{\"index\":" << event.arg << "}";
+			}
+			out << "}";
+		}
+	}
+	out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return out.good();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+/**
+ * Heap allocations made by a thread. They are only counted when the program is compiled with
+ * CURVE_DETECTION_ALLOC_TRACKING defined, which replaces the global operator new, and stay zero otherwise.
+ */
+class AllocationCount {
+public:
+	int64_t allocations;
+	int64_t bytes;
+
+public:
+	AllocationCount() : allocations(0), bytes(0) {}
+};
+
+/**
+ * Records scoped timings and writes them as Chrome trace-event JSON, which chrome://tracing and Perfetto display
+ * as one track per thread. Each thread appends to its own buffer, so recording takes no lock once the thread has
+ * registered its buffer with its first event. Nothing is recorded until start() is called, and write() must only
+ * be called once the traced threads are idle. With allocation tracking compiled in, each event also carries the
+ * allocations that its thread made during it and the peak resident memory of the process at its end.
+ */
+class Tracer {
+public:
+	static void start();
+	static bool enabled() { return recording; }
+	static bool write(const std::string& path);
+
+	static int64_t now();
+	static void record(const char* name, int64_t begin, int64_t end, int arg, const AllocationCount& begin_allocations);
+
+	static bool tracksAllocations();
+	static AllocationCount allocations();
+	static int64_t peakResidentKB();
+
+private:
+	static bool recording;
+};
+
+/**
+ * Records the time from its construction to its destruction as an event of the calling thread. The name must be
+ * a string literal, and arg, if not negative, is shown with the event, such as the index of a polygon.
+ */
+class TraceScope {
+private:
+	const char* name;
+	int arg;
+	int64_t begin;
+	AllocationCount begin_allocations;
+
+public:
+	TraceScope(const char* name, int arg = -1) : name(name), arg(arg), begin(0) {
+		if (Tracer::enabled()) {
+			begin_allocations = Tracer::allocations();
+			begin = Tracer::now();
+		}
+	}
+	~TraceScope() {
+		if (Tracer::enabled()) Tracer::record(name, begin, Tracer::now(), arg, begin_allocations);
+	}
+
+private:
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+};
@@ -1,43 +1,566 @@
 #include "Util.h"
+#include <opencv2/imgproc/imgproc_c.h>
+
+/**
+ * Threshold the roi of the image into buffer and trace its contours in RETR_CCOMP mode.
+ * The points of the returned contours are in image coordinates.
+ */
+static CvSeq* traceContours(const ImageView& image, const cv::Rect& roi, int threshold, cv::Mat& buffer, CvMemStorage* storage) {
+	// cvFindContours traces in place and requires a zero frame, so leave a 1 pixel margin around the roi
+	// instead of letting cv::findContours copy it into a bordered one
+	buffer.create(roi.height + 2, roi.width + 2, CV_8UC1);
+	cv::Mat src(roi.height, roi.width, CV_8UC1, const_cast<uchar*>(image.data + roi.y * image.stride + roi.x), image.stride);
+	cv::Mat interior = buffer(cv::Rect(1, 1, roi.width, roi.height));
+	cv::threshold(src, interior, threshold, 1, cv::THRESH_BINARY);
+
+	CvMat mat = buffer;
+	CvSeq* first_contour = NULL;
+	//cvFindContours(&mat, storage, &first_contour, sizeof(CvContour), CV_RETR_CCOMP, CV_CHAIN_APPROX_SIMPLE, cvPoint(roi.x - 1, roi.y - 1));
+	cvFindContours(&mat, storage, &first_contour, sizeof(CvContour), CV_RETR_CCOMP, CV_CHAIN_APPROX_NONE, cvPoint(roi.x - 1, roi.y - 1));
+
+	return first_contour;
+}
+
+static void readPoints(CvSeq* seq, Point* points) {
+	CvSeqReader reader;
+	cvStartReadSeq(seq, &reader);
+	for (int j = 0; j < seq->total; j++) {
+		CvPoint pt;
+		CV_READ_SEQ_ELEM(pt, reader);
+		points[j] = Point(pt.x, pt.y);
+	}
+}
+
+/**
+ * Append an outer contour and the holes hanging off its v_next as one polygon.
+ */
+static void appendPolygon(CvSeq* contour, PolygonSet& polygons) {
+	readPoints(contour, polygons.addRing(contour->total));
+
+	// obtain all the holes inside this contour
+	for (CvSeq* hole = contour->v_next; hole != NULL; hole = hole->h_next) {
+		readPoints(hole, polygons.addRing(hole->total));
+	}
+
+	polygons.endPolygon();
+}
+
+/**
+ * Reserve room in polygons for the outer contours with at least min_points points and their holes.
+ */
+static void reserve(CvSeq* first_contour, int min_points, PolygonSet& polygons) {
+	int num_points = polygons.points.size();
+	int num_rings = polygons.numRings();
+	int num_polygons = polygons.size();
+	for (CvSeq* contour = first_contour; contour != NULL; contour = contour->h_next) {
+		if (contour->total < min_points) continue;
+		num_points += contour->total;
+		num_rings++;
+		num_polygons++;
+		for (CvSeq* hole = contour->v_next; hole != NULL; hole = hole->h_next) {
+			num_points += hole->total;
+			num_rings++;
+		}
+	}
+
+	polygons.points.reserve(num_points);
+	polygons.ring_offsets.reserve(num_rings + 1);
+	polygons.ring_closed.reserve(num_rings);
+	polygons.polygon_offsets.reserve(num_polygons + 1);
+}
 
 std::vector<Polygon> findContours(const cv::Mat& image) {
-	std::vector<Polygon> polygons;
-
-	cv::Mat mat = image.clone();
-	cv::threshold(mat, mat, 40, 255, cv::THRESH_BINARY);
-
-	// extract contours
-	std::vector<std::vector<cv::Point>> contours;
-	std::vector<cv::Vec4i> hierarchy;
-	//cv::findContours(mat, contours, hierarchy, cv::RETR_CCOMP, cv::CHAIN_APPROX_SIMPLE, cv::Point(0, 0));
-	cv::findContours(mat, contours, hierarchy, cv::RETR_CCOMP, cv::CHAIN_APPROX_NONE, cv::Point(0, 0));
-
-	for (int i = 0; i < hierarchy.size(); i++) {
-		if (hierarchy[i][3] != -1) continue;
-		if (contours[i].size() < 3) continue;
-
-		Polygon polygon;
-		polygon.contour.resize(contours[i].size());
-		for (int j = 0; j < contours[i].size(); j++) {
-			polygon.contour[j] = Point(contours[i][j].x, contours[i][j].y);
-		}
-
-		if (polygon.contour.size() >= 3) {
-			// obtain all the holes inside this contour
-			int hole_id = hierarchy[i][2];
-			while (hole_id != -1) {
-				std::vector<Point> hole;
-				hole.resize(contours[hole_id].size());
-				for (int j = 0; j < contours[hole_id].size(); j++) {
-					hole[j] = Point(contours[hole_id][j].x, contours[hole_id][j].y);
+	cv::Mat buffer;
+	return findContours(ImageView(image), buffer, 40);
+}
+
+std::vector<Polygon> findContours(const ImageView& image, cv::Mat& buffer, int threshold) {
+	PolygonSet polygon_set;
+	findContours(image, buffer, polygon_set, 3, threshold);
+
+	std::vector<Polygon> polygons(polygon_set.size());
+	for (int i = 0; i < polygon_set.size(); i++) polygons[i] = polygon_set.polygon(i);
+
+	return polygons;
+}
+
+/**
+ * Extract the outer contours of the pixels brighter than threshold that have at least min_points points,
+ * together with their holes, into polygons.
+ * The image is thresholded straight from the source into buffer, which can be reused across calls and is
+ * overwritten with labels by the contour tracing.
+ */
+void findContours(const ImageView& image, cv::Mat& buffer, PolygonSet& polygons, int min_points, int threshold) {
+	polygons.clear();
+	min_points = std::max(min_points, 3);
+
+	CvMemStorage* storage = cvCreateMemStorage(0);
+	CvSeq* first_contour = traceContours(image, cv::Rect(0, 0, image.width, image.height), threshold, buffer, storage);
+
+	// the outer contours are linked by h_next
+	reserve(first_contour, min_points, polygons);
+	for (CvSeq* contour = first_contour; contour != NULL; contour = contour->h_next) {
+		if (contour->total < min_points) continue;
+		appendPolygon(contour, polygons);
+	}
+
+	cvReleaseMemStorage(&storage);
+}
+
+/**
+ * Threshold the image into runs of the pixels brighter than threshold, like cv::threshold with THRESH_BINARY.
+ */
+void RunLengthImage::create(const ImageView& image, int threshold) {
+	width = image.width;
+	height = image.height;
+	runs.clear();
+	row_offsets.resize(height + 1);
+
+	// with a threshold below 128, adding 127 - threshold to a byte sets its top bit exactly when the byte is above the
+	// threshold, without carrying into the next byte, so 8 pixels are tested at once
+	bool by_words = threshold >= 0 && threshold < 128;
+	const uint64 ones = 0x0101010101010101ULL;
+	const uint64 tops = ones * 0x80;
+	uint64 offset = ones * (127 - threshold);
+
+	for (int y = 0; y < height; y++) {
+		row_offsets[y] = runs.size();
+		const uchar* row = image.data + y * image.stride;
+		int x = 0;
+		while (true) {
+			// skip the background, which is most of the page, 8 pixels at a time
+			if (by_words) {
+				for (uint64 word; x + 8 <= width; x += 8) {
+					memcpy(&word, row + x, 8);
+					if (((word | (word + offset)) & tops) != 0) break;
 				}
-				polygon.holes.push_back(hole);
-				hole_id = hierarchy[hole_id][0];
 			}
+			while (x < width && row[x] <= threshold) x++;
+			if (x == width) break;
 
-			polygons.push_back(polygon);
+			int start = x;
+			while (x < width && row[x] > threshold) x++;
+			runs.push_back(cv::Range(start, x));
 		}
 	}
+	row_offsets[height] = runs.size();
+}
 
-	return polygons;
+/**
+ * Return true if the pixel is foreground. Pixels outside the image are background.
+ */
+bool RunLengthImage::at(int x, int y) const {
+	if (x < 0 || x >= width || y < 0 || y >= height) return false;
+
+	// the last run starting at or before x
+	const cv::Range* begin = runs.data() + row_offsets[y];
+	const cv::Range* end = runs.data() + row_offsets[y + 1];
+	const cv::Range* run = std::upper_bound(begin, end, x, [](int x, const cv::Range& run) { return x < run.start; });
+	return run != begin && x < (run - 1)->end;
+}
+
+static int findRoot(std::vector<int>& parent, int i) {
+	while (parent[i] != i) {
+		parent[i] = parent[parent[i]];
+		i = parent[i];
+	}
+	return i;
+}
+
+/**
+ * Follow the border starting at the given pixel in the same way as cvFindContours with CV_CHAIN_APPROX_NONE,
+ * so that the points come out identical. Directions are numbered counterclockwise from the right.
+ */
+static void traceBorder(const RunLengthImage& image, const cv::Point& start, bool hole, std::vector<cv::Point>& points) {
+	static const cv::Point DELTAS[8] = { cv::Point(1, 0), cv::Point(1, -1), cv::Point(0, -1), cv::Point(-1, -1), cv::Point(-1, 0), cv::Point(-1, 1), cv::Point(0, 1), cv::Point(1, 1) };
+
+	points.clear();
+
+	// outer borders have the background on their left, and holes on their right
+	int s_end = hole ? 0 : 4;
+	int s = s_end;
+	cv::Point first;
+	do {
+		s = (s - 1) & 7;
+		first = start + DELTAS[s];
+	} while (!image.at(first.x, first.y) && s != s_end);
+
+	// single pixel component
+	if (s == s_end) {
+		points.push_back(start);
+		return;
+	}
+
+	cv::Point cur = start;
+	while (true) {
+		// the next border pixel is the first foreground neighbour counterclockwise from the previous one
+		s_end = s;
+		cv::Point next;
+		do {
+			s = (s + 1) & 7;
+			next = cur + DELTAS[s];
+		} while (!image.at(next.x, next.y));
+
+		points.push_back(cur);
+
+		if (next == start && cur == first) break;
+
+		cur = next;
+		s = (s + 4) & 7;
+	}
+}
+
+/**
+ * Extract the outer contours that have at least min_points points, together with their holes, in the same
+ * order and with the same points as findContours on the dense image.
+ * Components and holes are labelled on the runs, so the time and memory grow with the ink and the length of the
+ * borders rather than with the area of the image.
+ */
+void findContours(const RunLengthImage& image, PolygonSet& polygons, int min_points) {
+	polygons.clear();
+	min_points = std::max(min_points, 3);
+
+	// label the 8-connected components of the runs
+	std::vector<int> parent(image.runs.size());
+	for (int i = 0; i < parent.size(); i++) parent[i] = i;
+	for (int y = 1; y < image.height; y++) {
+		int j = image.row_offsets[y - 1];
+		for (int i = image.row_offsets[y]; i < image.row_offsets[y + 1]; i++) {
+			// runs are 8-connected if they overlap after widening one of them by a pixel on each side
+			while (j < image.row_offsets[y] && image.runs[j].end < image.runs[i].start) j++;
+			for (int k = j; k < image.row_offsets[y] && image.runs[k].start <= image.runs[i].end; k++) {
+				parent[findRoot(parent, i)] = findRoot(parent, k);
+			}
+		}
+	}
+
+	// label the 4-connected components of the gaps between the runs, where label 0 is the background that
+	// surrounds the image
+	std::vector<cv::Range> gaps;
+	std::vector<int> gap_offsets(image.height + 1);
+	std::vector<int> gap_left_run;
+	for (int y = 0; y < image.height; y++) {
+		gap_offsets[y] = gaps.size();
+		int x = 0;
+		for (int i = image.row_offsets[y]; i < image.row_offsets[y + 1]; i++) {
+			if (image.runs[i].start > x) {
+				gaps.push_back(cv::Range(x, image.runs[i].start));
+				gap_left_run.push_back(i - 1);
+			}
+			x = image.runs[i].end;
+		}
+		if (x < image.width) {
+			gaps.push_back(cv::Range(x, image.width));
+			gap_left_run.push_back(image.row_offsets[y + 1] - 1);
+		}
+	}
+	gap_offsets[image.height] = gaps.size();
+
+	std::vector<int> gap_parent(gaps.size() + 1);
+	for (int i = 0; i < gap_parent.size(); i++) gap_parent[i] = i;
+	for (int y = 0; y < image.height; y++) {
+		int j = y > 0 ? gap_offsets[y - 1] : 0;
+		for (int i = gap_offsets[y]; i < gap_offsets[y + 1]; i++) {
+			const cv::Range& gap = gaps[i];
+			if (y == 0 || y == image.height - 1 || gap.start == 0 || gap.end == image.width) {
+				gap_parent[findRoot(gap_parent, i + 1)] = findRoot(gap_parent, 0);
+			}
+			if (y == 0) continue;
+
+			// gaps are 4-connected only if they share a column
+			while (j < gap_offsets[y] && gaps[j].end <= gap.start) j++;
+			for (int k = j; k < gap_offsets[y] && gaps[k].start < gap.end; k++) {
+				gap_parent[findRoot(gap_parent, i + 1)] = findRoot(gap_parent, k + 1);
+			}
+		}
+	}
+
+	// the scan of the dense image starts each border at the first pixel of its component or hole in raster order,
+	// so list the components by their first run and the holes under the component to their left
+	std::vector<int> component(image.runs.size(), -1);
+	std::vector<cv::Point> starts;
+	for (int y = 0; y < image.height; y++) {
+		for (int i = image.row_offsets[y]; i < image.row_offsets[y + 1]; i++) {
+			int root = findRoot(parent, i);
+			if (component[root] == -1) {
+				component[root] = starts.size();
+				starts.push_back(cv::Point(image.runs[i].start, y));
+			}
+		}
+	}
+
+	std::vector<std::vector<cv::Point>> hole_starts(starts.size());
+	std::vector<uchar> seen(gaps.size() + 1, 0);
+	seen[findRoot(gap_parent, 0)] = 1;
+	for (int y = 0; y < image.height; y++) {
+		for (int i = gap_offsets[y]; i < gap_offsets[y + 1]; i++) {
+			int root = findRoot(gap_parent, i + 1);
+			if (seen[root]) continue;
+			seen[root] = 1;
+			hole_starts[component[findRoot(parent, gap_left_run[i])]].push_back(cv::Point(gaps[i].start - 1, y));
+		}
+	}
+
+	// the dense scan returns the contours and the holes of each in the reverse order of their discovery
+	std::vector<cv::Point> points;
+	for (int c = starts.size() - 1; c >= 0; c--) {
+		traceBorder(image, starts[c], false, points);
+		if (points.size() < min_points) continue;
+
+		Point* contour = polygons.addRing(points.size());
+		for (int j = 0; j < points.size(); j++) contour[j] = Point(points[j].x, points[j].y);
+
+		for (int h = hole_starts[c].size() - 1; h >= 0; h--) {
+			traceBorder(image, hole_starts[c][h], true, points);
+			Point* hole = polygons.addRing(points.size());
+			for (int j = 0; j < points.size(); j++) hole[j] = Point(points[j].x, points[j].y);
+		}
+
+		polygons.endPolygon();
+	}
+}
+
+/**
+ * Return true if the rectangle touches or crosses a border between two tiles.
+ */
+static bool onTileBorder(const cv::Rect& rect, int tile_size, int width, int height) {
+	int x1 = rect.x + rect.width - 1;
+	int y1 = rect.y + rect.height - 1;
+	if (rect.x / tile_size != x1 / tile_size || rect.y / tile_size != y1 / tile_size) return true;
+	if ((rect.x % tile_size == 0 && rect.x > 0) || ((x1 + 1) % tile_size == 0 && x1 + 1 < width)) return true;
+	if ((rect.y % tile_size == 0 && rect.y > 0) || ((y1 + 1) % tile_size == 0 && y1 + 1 < height)) return true;
+	return false;
+}
+
+/**
+ * Merge the rectangles that overlap or are 8-connected until none of the merged ones does.
+ */
+static std::vector<cv::Rect> mergeRegions(std::vector<cv::Rect> regions) {
+	while (true) {
+		std::sort(regions.begin(), regions.end(), [](const cv::Rect& a, const cv::Rect& b) { return a.x < b.x; });
+
+		std::vector<int> group(regions.size());
+		for (int i = 0; i < regions.size(); i++) group[i] = i;
+		std::function<int(int)> find = [&](int i) { return group[i] == i ? i : group[i] = find(group[i]); };
+
+		for (int i = 0; i < regions.size(); i++) {
+			cv::Rect expanded(regions[i].x - 1, regions[i].y - 1, regions[i].width + 2, regions[i].height + 2);
+			for (int j = i + 1; j < regions.size() && regions[j].x < expanded.x + expanded.width; j++) {
+				if ((expanded & regions[j]).area() > 0) group[find(j)] = find(i);
+			}
+		}
+
+		std::vector<cv::Rect> merged;
+		std::vector<int> index(regions.size(), -1);
+		for (int i = 0; i < regions.size(); i++) {
+			int root = find(i);
+			if (index[root] == -1) {
+				index[root] = merged.size();
+				merged.push_back(regions[i]);
+			}
+			else {
+				merged[index[root]] |= regions[i];
+			}
+		}
+
+		if (merged.size() == regions.size()) return merged;
+		regions = merged;
+	}
+}
+
+/**
+ * Return true if the components that cross the borders between tiles may span more than half of the image, as the
+ * frame of a drawing does. The image is reduced to blocks of block_size x block_size that are foreground if any of
+ * their pixels is, and the 8-connected components of the blocks are merged as findContoursTiled merges the
+ * fragments. A reduced component contains the real ones it covers, so the extent is only ever overestimated.
+ */
+static bool spansTiles(const ImageView& image, int tile_size, int threshold, int block_size) {
+	int blocks_x = (image.width + block_size - 1) / block_size;
+	int blocks_y = (image.height + block_size - 1) / block_size;
+	cv::Mat blocks(blocks_y, blocks_x, CV_8UC1);
+	cv::parallel_for_(cv::Range(0, blocks_y), [&](const cv::Range& range) {
+		for (int by = range.start; by < range.end; by++) {
+			uchar* row = blocks.ptr<uchar>(by);
+			std::fill(row, row + blocks_x, 0);
+			for (int y = by * block_size; y < std::min((by + 1) * block_size, image.height); y++) {
+				const uchar* src = image.data + y * image.stride;
+				for (int bx = 0; bx < blocks_x; bx++) {
+					if (row[bx]) continue;
+					for (int x = bx * block_size; x < std::min((bx + 1) * block_size, image.width); x++) {
+						if (src[x] > threshold) {
+							row[bx] = 1;
+							break;
+						}
+					}
+				}
+			}
+		}
+	});
+
+	cv::Mat labels, stats, centroids;
+	int num_labels = cv::connectedComponentsWithStats(blocks, labels, stats, centroids, 8, CV_32S);
+
+	std::vector<cv::Rect> crossing;
+	for (int i = 1; i < num_labels; i++) {
+		cv::Rect rect(stats.at<int>(i, cv::CC_STAT_LEFT) * block_size, stats.at<int>(i, cv::CC_STAT_TOP) * block_size,
+			stats.at<int>(i, cv::CC_STAT_WIDTH) * block_size, stats.at<int>(i, cv::CC_STAT_HEIGHT) * block_size);
+		rect &= cv::Rect(0, 0, image.width, image.height);
+		if (onTileBorder(rect, tile_size, image.width, image.height)) crossing.push_back(rect);
+	}
+
+	std::vector<cv::Rect> regions = mergeRegions(crossing);
+	for (auto& region : regions) {
+		if (2.0 * region.area() > (double)image.width * image.height) return true;
+	}
+	return false;
+}
+
+/**
+ * Extract the same polygons as findContours, in the same order, by tracing tiles of tile_size x tile_size in parallel.
+ * The components that touch a border between tiles are traced again over the merged bounding box of their
+ * fragments, so only those regions and one tile per thread are ever thresholded.
+ * When such a region may cover most of the image, as with a frame around a drawing, tracing it again would cost
+ * as much as the plain trace on top of the tiles, so the image is traced by findContours instead.
+ */
+void findContoursTiled(const ImageView& image, PolygonSet& polygons, int min_points, int tile_size, int threshold) {
+	polygons.clear();
+	min_points = std::max(min_points, 3);
+
+	int tiles_x = (image.width + tile_size - 1) / tile_size;
+	int tiles_y = (image.height + tile_size - 1) / tile_size;
+	if (tiles_x * tiles_y > 1 && spansTiles(image, tile_size, threshold, 4)) {
+		cv::Mat buffer;
+		findContours(image, buffer, polygons, min_points, threshold);
+		return;
+	}
+
+	// trace each tile, and defer the components crossing into other tiles
+	std::vector<PolygonSet> tile_polygons(tiles_x * tiles_y);
+	std::vector<std::vector<cv::Rect>> tile_fragments(tiles_x * tiles_y);
+	cv::parallel_for_(cv::Range(0, tiles_x * tiles_y), [&](const cv::Range& range) {
+		cv::Mat buffer;
+		CvMemStorage* storage = cvCreateMemStorage(0);
+		for (int t = range.start; t < range.end; t++) {
+			int x = (t % tiles_x) * tile_size;
+			int y = (t / tiles_x) * tile_size;
+			cv::Rect tile(x, y, std::min(tile_size, image.width - x), std::min(tile_size, image.height - y));
+
+			for (CvSeq* contour = traceContours(image, tile, threshold, buffer, storage); contour != NULL; contour = contour->h_next) {
+				cv::Rect rect = cvBoundingRect(contour, 1);
+				if (onTileBorder(rect, tile_size, image.width, image.height)) {
+					tile_fragments[t].push_back(rect);
+				}
+				else if (contour->total >= min_points) {
+					appendPolygon(contour, tile_polygons[t]);
+				}
+			}
+			cvClearMemStorage(storage);
+		}
+		cvReleaseMemStorage(&storage);
+	});
+
+	// stitch the fragments by tracing the regions that cover whole components
+	std::vector<cv::Rect> fragments;
+	for (auto& f : tile_fragments) fragments.insert(fragments.end(), f.begin(), f.end());
+	std::vector<cv::Rect> regions = mergeRegions(fragments);
+
+	std::vector<PolygonSet> region_polygons(regions.size());
+	cv::parallel_for_(cv::Range(0, (int)regions.size()), [&](const cv::Range& range) {
+		cv::Mat buffer;
+		CvMemStorage* storage = cvCreateMemStorage(0);
+		for (int r = range.start; r < range.end; r++) {
+			// the components entirely inside a tile were already emitted by it
+			for (CvSeq* contour = traceContours(image, regions[r], threshold, buffer, storage); contour != NULL; contour = contour->h_next) {
+				if (contour->total < min_points) continue;
+				if (!onTileBorder(cvBoundingRect(contour, 1), tile_size, image.width, image.height)) continue;
+				appendPolygon(contour, region_polygons[r]);
+			}
+			cvClearMemStorage(storage);
+		}
+		cvReleaseMemStorage(&storage);
+	});
+
+	std::vector<PolygonSet*> sets;
+	for (auto& p : tile_polygons) sets.push_back(&p);
+	for (auto& p : region_polygons) sets.push_back(&p);
+
+	// a single pass finds the outer contours in raster order of their first points and returns them reversed
+	std::vector<std::pair<int, int>> order;
+	int num_points = 0;
+	int num_rings = 0;
+	for (int s = 0; s < sets.size(); s++) {
+		for (int p = 0; p < sets[s]->size(); p++) order.push_back(std::make_pair(s, p));
+		num_points += sets[s]->points.size();
+		num_rings += sets[s]->numRings();
+	}
+	std::sort(order.begin(), order.end(), [&](const std::pair<int, int>& a, const std::pair<int, int>& b) {
+		const cv::Point2f& pa = sets[a.first]->contour(a.second)->pos;
+		const cv::Point2f& pb = sets[b.first]->contour(b.second)->pos;
+		return pa.y > pb.y || (pa.y == pb.y && pa.x > pb.x);
+	});
+
+	polygons.points.reserve(num_points);
+	polygons.ring_offsets.reserve(num_rings + 1);
+	polygons.ring_closed.reserve(num_rings);
+	polygons.polygon_offsets.reserve(order.size() + 1);
+	for (auto& o : order) polygons.append(*sets[o.first], o.second);
+}
+
+/**
+ * Copy polygons into resampled, dropping points along the locally smooth parts of each ring.
+ * A point is kept once the arc length from the previously kept one reaches max_spacing, or wherever the ring
+ * turns by more than max_turning_angle between the max_spacing neighbours on either side, so high curvature
+ * keeps its full density. The kept points are original points, not interpolated ones.
+ */
+void resampleContours(const PolygonSet& polygons, PolygonSet& resampled, float max_spacing, float max_turning_angle) {
+	resampled.clear();
+	resampled.points.reserve(polygons.points.size());
+	resampled.ring_offsets.reserve(polygons.ring_offsets.size());
+	resampled.ring_closed.reserve(polygons.ring_closed.size());
+	resampled.polygon_offsets.reserve(polygons.polygon_offsets.size());
+
+	int window = std::max(1, (int)std::round(max_spacing));
+	float cos_threshold = std::cos(max_turning_angle);
+
+	std::vector<int> kept;
+	for (int p = 0; p < polygons.size(); p++) {
+		for (int r = polygons.polygon_offsets[p]; r < polygons.polygon_offsets[p + 1]; r++) {
+			const Point* ring = polygons.ring(r);
+			int N = polygons.ringSize(r);
+			bool closed = polygons.isClosed(r);
+
+			kept.clear();
+			float length = 0;
+			for (int i = 0; i < N; i++) {
+				if (i > 0) length += cv::norm(ring[i].pos - ring[i - 1].pos);
+
+				// small rings are kept as they are, and so are both ends of open ones
+				bool smooth = N > window * 2 && (closed || (i >= window && i < N - window));
+				if (smooth) {
+					cv::Point2f a = ring[i].pos - ring[(i - window + N) % N].pos;
+					cv::Point2f b = ring[(i + window) % N].pos - ring[i].pos;
+					smooth = a.dot(b) >= cos_threshold * cv::norm(a) * cv::norm(b);
+				}
+
+				if (i == 0 || !smooth || length >= max_spacing) {
+					kept.push_back(i);
+					length = 0;
+				}
+			}
+
+			Point* out = resampled.addRing(kept.size(), closed);
+			for (int i = 0; i < kept.size(); i++) out[i] = ring[kept[i]];
+		}
+		resampled.endPolygon();
+	}
+}
+
+/**
+ * Return the number of points left per original point along the smooth runs of contours resampled with
+ * max_spacing, where the circles and lines lie. The original points are about a pixel apart, so a point is
+ * kept about every ceil(max_spacing) of them there, while the corners keep all theirs. The point counts and index
+ * distances of the detectors are scaled by it, so that they keep standing for the same arc length.
+ */
+float resampledDensity(float max_spacing) {
+	return max_spacing > 1 ? 1.0f / std::ceil(max_spacing) : 1.0f;
 }
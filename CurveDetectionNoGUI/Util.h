@@ -32,4 +32,128 @@ public:
 	}
 };
 
+/**
+ * The contours and holes of an image stored in one flat point buffer.
+ * Ring r spans points[ring_offsets[r], ring_offsets[r + 1]), and polygon p consists of the contour ring
+ * polygon_offsets[p] followed by its holes up to ring polygon_offsets[p + 1]. Contours and holes are closed rings,
+ * while centerlines are stored as polygons without holes whose ring may be open.
+ * clear() keeps the capacity, so a set reused across images stops allocating once it has grown.
+ */
+class PolygonSet {
+public:
+	std::vector<Point> points;
+	std::vector<int> ring_offsets;
+	std::vector<int> polygon_offsets;
+	std::vector<uchar> ring_closed;
+
+public:
+	PolygonSet() { clear(); }
+
+	void clear() {
+		points.clear();
+		ring_offsets.assign(1, 0);
+		polygon_offsets.assign(1, 0);
+		ring_closed.clear();
+	}
+
+	void swap(PolygonSet& other) {
+		points.swap(other.points);
+		ring_offsets.swap(other.ring_offsets);
+		polygon_offsets.swap(other.polygon_offsets);
+		ring_closed.swap(other.ring_closed);
+	}
+
+	int size() const { return polygon_offsets.size() - 1; }
+	int numRings() const { return ring_offsets.size() - 1; }
+	Point* ring(int r) { return points.data() + ring_offsets[r]; }
+	const Point* ring(int r) const { return points.data() + ring_offsets[r]; }
+	int ringSize(int r) const { return ring_offsets[r + 1] - ring_offsets[r]; }
+	bool isClosed(int r) const { return ring_closed[r] != 0; }
+
+	Point* contour(int p) { return ring(polygon_offsets[p]); }
+	const Point* contour(int p) const { return ring(polygon_offsets[p]); }
+	int contourSize(int p) const { return ringSize(polygon_offsets[p]); }
+	bool isContourClosed(int p) const { return isClosed(polygon_offsets[p]); }
+	int numHoles(int p) const { return polygon_offsets[p + 1] - polygon_offsets[p] - 1; }
+	Point* hole(int p, int h) { return ring(polygon_offsets[p] + 1 + h); }
+	const Point* hole(int p, int h) const { return ring(polygon_offsets[p] + 1 + h); }
+	int holeSize(int p, int h) const { return ringSize(polygon_offsets[p] + 1 + h); }
+
+	/**
+	 * Append a ring of the given size to the current polygon and return its points.
+	 * The first ring of a polygon is its contour.
+	 */
+	Point* addRing(int size, bool closed = true) {
+		points.resize(points.size() + size);
+		ring_offsets.push_back(points.size());
+		ring_closed.push_back(closed);
+		return ring(numRings() - 1);
+	}
+
+	void endPolygon() { polygon_offsets.push_back(numRings()); }
+
+	void append(const PolygonSet& other, int p) {
+		for (int r = other.polygon_offsets[p]; r < other.polygon_offsets[p + 1]; r++) {
+			std::copy(other.ring(r), other.ring(r) + other.ringSize(r), addRing(other.ringSize(r), other.isClosed(r)));
+		}
+		endPolygon();
+	}
+
+	Polygon polygon(int p) const {
+		Polygon polygon;
+		polygon.contour.assign(contour(p), contour(p) + contourSize(p));
+		for (int h = 0; h < numHoles(p); h++) {
+			polygon.holes.push_back(std::vector<Point>(hole(p, h), hole(p, h) + holeSize(p, h)));
+		}
+		return polygon;
+	}
+
+	void clearUsedFlag() {
+		for (auto& pt : points) pt.used = false;
+	}
+};
+
+/**
+ * Non-owning view of an 8-bit grayscale image, e.g. QImage::constBits() or a decoded cv::Mat.
+ * Rows are stride bytes apart.
+ */
+class ImageView {
+public:
+	const uchar* data;
+	int width;
+	int height;
+	size_t stride;
+
+public:
+	ImageView() : data(NULL), width(0), height(0), stride(0) {}
+	ImageView(const uchar* data, int width, int height, size_t stride) : data(data), width(width), height(height), stride(stride) {}
+	ImageView(const cv::Mat& image) : data(image.data), width(image.cols), height(image.rows), stride(image.step) {}
+};
+
+/**
+ * Binary image stored as the runs of foreground pixels in each row, so that its size grows with the ink rather
+ * than with the page. The runs of row y are runs[row_offsets[y], row_offsets[y + 1]) in increasing order, and
+ * each covers the pixels [start, end).
+ * create() keeps the capacity, so an image reused across pages stops allocating once it has grown.
+ */
+class RunLengthImage {
+public:
+	int width;
+	int height;
+	std::vector<cv::Range> runs;
+	std::vector<int> row_offsets;
+
+public:
+	RunLengthImage() : width(0), height(0) {}
+
+	void create(const ImageView& image, int threshold = 40);
+	bool at(int x, int y) const;
+};
+
 std::vector<Polygon> findContours(const cv::Mat& image);
+std::vector<Polygon> findContours(const ImageView& image, cv::Mat& buffer, int threshold = 40);
+void findContours(const ImageView& image, cv::Mat& buffer, PolygonSet& polygons, int min_points = 3, int threshold = 40);
+void findContours(const RunLengthImage& image, PolygonSet& polygons, int min_points = 3);
+void findContoursTiled(const ImageView& image, PolygonSet& polygons, int min_points = 3, int tile_size = 2048, int threshold = 40);
+void resampleContours(const PolygonSet& polygons, PolygonSet& resampled, float max_spacing, float max_turning_angle = 0.3f);
+float resampledDensity(float max_spacing);
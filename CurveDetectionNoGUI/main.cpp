@@ -1,47 +1,106 @@
 #include <iostream>
-#include "CurveDetector.h"
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include "Pipeline.h"
+#include "Daemon.h"
+#include "Tracer.h"
 
 int main(int argc, char *argv[]) {
-	if (argc != 3) {
-		std::cout << "Usage: " << argv[0] << " <input image file> <output image file>" << std::endl;
-		return -1;
+	Pipeline pipeline;
+	bool batch = false;
+	std::string sweep_grid;
+	std::string cache_dir;
+	std::string daemon_address;
+	std::string trace_path;
+	std::string results_path;
+	ResultWriter::Format results_format = ResultWriter::NDJSON;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "--resample" && i + 1 < argc) pipeline.resample_spacing = std::atof(argv[++i]);
+		else if (arg == "--centerline") pipeline.centerline = true;
+		else if (arg == "--batch") batch = true;
+		else if (arg == "--workers" && i + 1 < argc) pipeline.num_workers = std::max(1, std::atoi(argv[++i]));
+		else if (arg == "--lines") pipeline.detect_lines = true;
+		else if (arg == "--results" && i + 1 < argc) results_path = argv[++i];
+		else if (arg == "--binary") results_format = ResultWriter::BINARY;
+		else if (arg == "--no-render") pipeline.render = false;
+		else if (arg == "--sweep" && i + 1 < argc) sweep_grid = argv[++i];
+		else if (arg == "--cache" && i + 1 < argc) cache_dir = argv[++i];
+		else if (arg == "--daemon" && i + 1 < argc) daemon_address = argv[++i];
+		else if (arg == "--stats") pipeline.stats = true;
+		else if (arg == "--trace" && i + 1 < argc) trace_path = argv[++i];
+		else if (arg == "--seed" && i + 1 < argc) pipeline.seed = std::strtoull(argv[++i], NULL, 10);
+		else files.push_back(arg);
 	}
 
-	// load image
-	cv::Mat image = cv::imread(argv[1], cv::IMREAD_GRAYSCALE);
+	if (pipeline.stats && !DetectorStats::enabled()) {
+		std::cerr << "The detector counters were compiled out, rebuild with CURVE_DETECTION_STATS defined to collect them" << std::endl;
+	}
 
-	// find contours
-	std::vector<Polygon> polygons = findContours(image);
+	// reuse the contours of the images that were seen before
+	ContourCache cache(cache_dir);
+	if (!cache_dir.empty()) pipeline.cache = &cache;
 
-	// detect circles
-	std::vector<Circle> circles;
-	for (int i = 0; i < polygons.size(); i++) {
-		if (polygons[i].contour.size() < 100) continue;
+	// serve the requests of other processes until the daemon is killed
+	if (!daemon_address.empty()) {
+		Daemon daemon(pipeline, results_format);
+		return daemon.serve(daemon_address);
+	}
 
-		std::vector<Circle> results;
-		CurveDetector::detect(polygons[i].contour, 200000, 200, 0.02, 30, 90 / 180.0 * CV_PI, 80, 400, results);
-		circles.insert(circles.end(), results.begin(), results.end());
+	// the output image, or directory, can only be left out when nothing is rendered
+	if (!sweep_grid.empty()) pipeline.render = false;
+	if (files.size() != 2 && !(files.size() == 1 && !pipeline.render)) {
+		std::cout << "Usage: " << argv[0] << " [options] <input image file> <output image file>" << std::endl;
+		std::cout << "       " << argv[0] << " [options] --batch [--workers <n>] <input directory|glob|manifest> <output directory>" << std::endl;
+		std::cout << "       " << argv[0] << " [options] [--workers <n>] --sweep <grid|grid file> <input image|directory|glob|manifest>" << std::endl;
+		std::cout << "       " << argv[0] << " [options] [--workers <n>] --daemon <socket path|port on Windows>" << std::endl;
+		std::cout << "Options: [--resample <spacing>] [--centerline] [--lines] [--results <file|-> [--binary]] [--no-render] [--cache <directory>] [--stats] [--trace <trace.json>] [--seed <n>]" << std::endl;
+		return -1;
 	}
+	files.resize(2);
 
-	if (circles.size() > 0) {
-		// generate output image
-		cv::Mat result(image.size(), CV_8UC3, cv::Scalar(255, 255, 255));
-		for (auto& polygon : polygons) {
-			std::vector<cv::Point> pol;
-			for (auto& pt : polygon.contour) pol.push_back(pt.pos);
-			cv::polylines(result, pol, true, cv::Scalar(0, 0, 0), 1);
-			for (auto& hole : polygon.holes) {
-				std::vector<cv::Point> pol;
-				for (auto& pt : hole) pol.push_back(pt.pos);
-				cv::polylines(result, pol, true, cv::Scalar(0, 0, 0), 1);
-			}
-		}
-		for (auto& circle : circles) {
-			cv::ellipse(result, cv::Point(circle.center.x, circle.center.y), cv::Size(circle.radius, circle.radius), 0, circle.start_angle / CV_PI * 180, circle.end_angle / CV_PI * 180, cv::Scalar(255, 0, 0), 3);
+	// stream the primitives as NDJSON, or in the compact binary format
+	ResultWriter writer;
+	if (!results_path.empty()) {
+		if (!writer.open(results_path, results_format)) {
+			std::cerr << "Cannot open " << results_path << std::endl;
+			return -1;
 		}
+		pipeline.writer = &writer;
+	}
+
+	if (!trace_path.empty()) Tracer::start();
+
+	int status = 0;
+	if (!sweep_grid.empty()) {
+		std::vector<Parameters> configs;
+		if (!Parameters::grid(sweep_grid, pipeline.params, configs)) return -1;
+		std::vector<std::string> inputs = Pipeline::listInputs(files[0]);
+
+		int num_processed = pipeline.sweep(inputs, configs);
+		status = num_processed == inputs.size() ? 0 : 1;
+	}
+	else if (batch) {
+		std::vector<std::string> inputs = Pipeline::listInputs(files[0]);
+
+		auto start = std::chrono::steady_clock::now();
+		int num_processed = pipeline.run(inputs, files[1]);
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if (num_processed >= 0) std::cerr << "Processed " << num_processed << " of " << inputs.size() << " images in " << elapsed << " s" << std::endl;
+		status = num_processed == inputs.size() ? 0 : 1;
+	}
+	else {
+		Job job(files[0], files[1]);
+		status = pipeline.process(job) ? 0 : 1;
+	}
+	writer.close();
 
-		cv::imwrite(argv[2], result);
+	// load the trace into chrome://tracing or ui.perfetto.dev
+	if (!trace_path.empty() && !Tracer::write(trace_path)) {
+		std::cerr << "Cannot write " << trace_path << std::endl;
 	}
 
-	return 0;
-}
\ No newline at end of file
+	return status;
+}